@@ -8,10 +8,10 @@
 #include "IMGRenameDlg.h"
 #include "afxdialogex.h"
 
-#include <string.h>         // For wcslen()
 #include <string>           // For std::wstring
 
 #include "Tools.h"
+#include "Engine.h"
 
 using namespace Registry;
 
@@ -19,6 +19,9 @@ using namespace Registry;
 #define new DEBUG_NEW
 #endif
 
+static const UINT WM_RENAME_DONE = WM_APP + 1;         // posted by the worker thread when the run is over
+static const UINT_PTR ProgressTimer = 1;
+
 
 // CAboutDlg dialog used for App About
 
@@ -70,6 +73,15 @@ CIMGRenameDlg::CIMGRenameDlg(CWnd* pParent /*=NULL*/)
   m_subdir = Reg::GetInt(HKEY_CURRENT_USER, CIMGRenameApp::AppName, L"SubDirs", 0);
 }
 
+CIMGRenameDlg::~CIMGRenameDlg()
+{
+  if (Running())                                        // window gone while renaming: stop at the next directory
+  {
+    m_cancel->Cancel();
+    m_worker.join();
+  }
+}
+
 void CIMGRenameDlg::DoDataExchange(CDataExchange* pDX)
 {
 	CDialogEx::DoDataExchange(pDX);
@@ -85,6 +97,8 @@ BEGIN_MESSAGE_MAP(CIMGRenameDlg, CDialogEx)
 	ON_WM_PAINT()
 	ON_WM_QUERYDRAGICON()
   ON_BN_CLICKED(IDC_SELECT, OnSelect)
+  ON_WM_TIMER()
+  ON_MESSAGE(WM_RENAME_DONE, OnRenameDone)
 END_MESSAGE_MAP()
 
 
@@ -180,11 +194,103 @@ void CIMGRenameDlg::OnSelect()
   UpdateData(FALSE);
 }
 
+void CIMGRenameDlg::EnableInput(BOOL enable)
+{
+  for (int id : { IDOK, IDC_PATH, IDC_SELECT, IDC_FROM, IDC_REPLACE, IDC_SUBDIR }) GetDlgItem(id)->EnableWindow(enable);
+}
+
+void CIMGRenameDlg::ShowProgress()
+{
+  CString status{};
+  status.Format(L"%Iu directories, %Iu files matched, %Iu renamed, %Iu failed, %.1f MB/s read", m_progress->directories.load(),
+    m_progress->matched.load(), m_progress->renamed.load(), m_progress->failed.load(), m_progress->BytesPerSecond() / (1024 * 1024));
+  if (m_cancelling) status += L" - cancelling";
+  SetDlgItemText(IDC_STATUS, status);
+}
+
+void CIMGRenameDlg::OnTimer(UINT_PTR nIDEvent)
+{
+  if (nIDEvent == ProgressTimer && m_progress) ShowProgress();
+  else CDialogEx::OnTimer(nIDEvent);
+}
+
 void CIMGRenameDlg::OnOK()
 {
+  if (Running()) return;
   UpdateData(TRUE);
 
-  ProcessDirectory(m_path.GetString());
+  Engine::Options options{};
+  options.path = m_path.GetString();
+  options.from = m_from.GetString();
+  options.to = m_replace.GetString();
+  options.subdir = m_subdir != FALSE;
+  m_progress = std::make_unique<Engine::Progress>();
+  m_cancel = std::make_unique<Engine::CancelToken>();
+  options.progress = m_progress.get();
+  options.cancel = m_cancel.get();
+  m_cancelling = false;
+
+  // the UI thread stays free to paint, show progress and take Cancel
+  EnableInput(FALSE);
+  SetTimer(ProgressTimer, 250, nullptr);
+  HWND wnd = GetSafeHwnd();
+  m_worker = std::thread([this, options, wnd]
+    {
+      try
+      {
+        m_result = Engine::Renamer(options).Run();
+      }
+      catch (const std::exception& e)
+      {
+        m_result = Engine::Result{};
+        m_result.failures.push_back(Engine::Failure{ options.path, e.what(), 0 });
+      }
+      ::PostMessage(wnd, WM_RENAME_DONE, 0, 0);
+    });
+}
+
+void CIMGRenameDlg::OnCancel()
+{
+  if (!Running())
+  {
+    CDialogEx::OnCancel();
+    return;
+  }
+  m_cancel->Cancel();                                   // the worker stops at the next directory and reports back
+  m_cancelling = true;
+  ShowProgress();
+}
+
+LRESULT CIMGRenameDlg::OnRenameDone(WPARAM, LPARAM)
+{
+  m_worker.join();
+  KillTimer(ProgressTimer);
+  ShowProgress();
+  EnableInput(TRUE);
+
+  const Engine::Result& result = m_result;
+  if (result.cancelled)
+  {
+    CString status{};
+    status.Format(L"Cancelled: %Iu files renamed, the rest left as they were", result.renamed);
+    SetDlgItemText(IDC_STATUS, status);
+  }
+  if (!result.failures.empty())
+  {
+    CString msg{};
+    msg.Format(L"%Iu files renamed, %Iu failed:\n", result.renamed, result.failures.size());
+    size_t shown = 0;
+    for (const Engine::Failure& f : result.failures)
+    {
+      if (++shown > 10) { msg += L"...\n"; break; }   // keep the message box on screen
+      CString line{};
+      line.Format(L"%s: %S\n", f.path.c_str(), f.message.c_str());
+      msg += line;
+    }
+    AfxMessageBox(msg, MB_ICONERROR);
+    return 0;
+  }
+  if (result.cancelled) return 0;
 
   // save defaults for next runs
   std::wstring regval{};
@@ -197,48 +303,5 @@ void CIMGRenameDlg::OnOK()
   Reg::SetInt(HKEY_CURRENT_USER, CIMGRenameApp::AppName, L"SubDirs", m_subdir);
 
   CDialog::OnOK();
-}
-
-
-void CIMGRenameDlg::ProcessFiles(std::wstring path)
-{
-  std::wstring Pattern = path + L"\\" + m_from.GetString() + L"*.*";
-  WIN32_FIND_DATA data;
-
-  HANDLE h = ::FindFirstFile(Pattern.c_str(), &data);
-  BOOL more = (h != INVALID_HANDLE_VALUE);
-  while (more)
-  {
-		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
-		{
-			CString Path = path.c_str();
-			CString OldName = Path + L"\\" + data.cFileName;
-			CString NewName = Path + L"\\" + m_replace + (data.cFileName + wcslen(m_from.GetString()));
-			CFile::Rename(OldName, NewName);
-		}
-    more = FindNextFile(h, &data);
-  };
-  ::FindClose(h);
-}
-
-void CIMGRenameDlg::ProcessDirectory(std::wstring path)
-{
-  ProcessFiles(path);
-  if (!m_subdir) return;
-
-  std::wstring pattern = path + L"\\*.*";
-  WIN32_FIND_DATA data;
-  HANDLE h = ::FindFirstFile(pattern.c_str(), &data);
-  BOOL more = (h != INVALID_HANDLE_VALUE);
-  while (more)
-  {
-    if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-      if (wcscmp(data.cFileName, L".") != 0 && wcscmp(data.cFileName, L"..") != 0)
-      {
-        ProcessDirectory(path + L"\\" + data.cFileName);
-      }
-    }
-    more = FindNextFile(h, &data);
-  };
-  ::FindClose(h);
+  return 0;
 }
@@ -1,12 +1,19 @@
 #ifndef IMGRENAMEDLG
 #define IMGRENAMEDLG
 
+#include <memory>           // For std::unique_ptr
+#include <thread>
+
+#include "Engine.h"
+#include "Progress.h"
+
 // CIMGRenameDlg dialog
 class CIMGRenameDlg : public CDialogEx
 {
 // Construction
 public:
 	CIMGRenameDlg(CWnd* pParent = NULL);	// standard constructor
+  ~CIMGRenameDlg();
 
 // Dialog Data
 #ifdef AFX_DESIGN_TIME
@@ -25,6 +32,17 @@ public:
 protected:
 	HICON m_hIcon;
 
+  // the rename runs on m_worker; the UI polls m_progress on a timer and hears about the end through WM_RENAME_DONE
+  std::thread m_worker;
+  std::unique_ptr<Engine::Progress> m_progress;
+  std::unique_ptr<Engine::CancelToken> m_cancel;
+  Engine::Result m_result;                              // written by the worker, read after it is joined
+  bool m_cancelling{};
+
+  bool Running() const { return m_worker.joinable(); }
+  void EnableInput(BOOL enable);
+  void ShowProgress();
+
 	// Generated message map functions
 	virtual BOOL OnInitDialog();
 	afx_msg void OnSysCommand(UINT nID, LPARAM lParam);
@@ -32,10 +50,10 @@ protected:
 	afx_msg HCURSOR OnQueryDragIcon();
   afx_msg void OnSelect();
   virtual void OnOK();
+  virtual void OnCancel();
+  afx_msg void OnTimer(UINT_PTR nIDEvent);
+  afx_msg LRESULT OnRenameDone(WPARAM wParam, LPARAM lParam);
 	DECLARE_MESSAGE_MAP()
-
-  void ProcessFiles(std::wstring path);
-  void ProcessDirectory(std::wstring path);
 };
 
 #endif  IMGRENAMEDLG
@@ -0,0 +1,107 @@
+// PrefixBench.cpp : prefix test over a large synthetic directory listing, SIMD against the scalar loop
+//
+
+#include <chrono>
+#include <cstdint>          // For uint8_t
+#include <cstdlib>          // For std::atoi
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "Arena.h"
+#include "Platform.h"
+#include "Prefix.h"
+
+using Engine::Char;
+using Engine::StringView;
+
+// names as a camera card or an archive directory has them: mostly the prefix, some other cameras, some lower case
+static std::vector<StringView> Names(size_t count, Engine::Arena& arena)
+{
+  static const StringView prefixes[]{ IMG_TEXT("IMG_"), IMG_TEXT("img_"), IMG_TEXT("DSC_"), IMG_TEXT("PXL_20240101_"), IMG_TEXT("IMGP"), IMG_TEXT("MVI_") };
+  std::mt19937 random(42);
+  std::vector<StringView> names{};
+  names.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    StringView prefix = prefixes[random() % 6];
+    Engine::String number = Engine::ToString(random() % 10000) + IMG_TEXT(".JPG");
+    names.push_back(arena.Concat(prefix, number));
+  }
+  return names;
+}
+
+template <typename Test> static double Measure(const std::vector<StringView>& names, unsigned rounds, size_t& matches, Test test)
+{
+  auto start = std::chrono::steady_clock::now();
+  matches = 0;
+  for (unsigned r = 0; r < rounds; ++r)
+  {
+    for (StringView name : names) matches += test(name) ? 1 : 0;
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(names.size()) * rounds);
+}
+
+int main(int argc, char* argv[])
+{
+  size_t count = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 1000000;
+  unsigned rounds = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 10;
+
+  Engine::Arena arena{};
+  std::vector<StringView> names = Names(count, arena);
+
+  // the same names as a directory scan has them: NUL terminated, one after the other, spare bytes at the end
+  std::vector<Char> packed{};
+  std::vector<const Char*> pointers{};
+  std::vector<uint8_t> flags(names.size());
+  for (StringView name : names)
+  {
+    packed.insert(packed.end(), name.begin(), name.end());
+    packed.push_back(Char{});
+  }
+  packed.resize(packed.size() + 16 / sizeof(Char));
+  for (size_t i = 0, at = 0; i < names.size(); at += names[i++].size() + 1) pointers.push_back(packed.data() + at);
+
+#if defined(IMG_AVX2)
+  std::cout << "SSE2: yes, AVX2: yes" << std::endl;
+#elif defined(IMG_SSE2)
+  std::cout << "SSE2: yes, AVX2: no" << std::endl;
+#else
+  std::cout << "SSE2: no, every column runs the scalar loop" << std::endl;
+#endif
+  std::cout << count << " names, " << rounds << " rounds, ns per name" << std::endl;
+
+  for (bool fold : { false, true })
+  {
+    Engine::PrefixMatcher matcher(IMG_TEXT("IMG_"), fold);
+    size_t scalarMatches{}, simdMatches{};
+    double scalar = Measure(names, rounds, scalarMatches, [&](StringView n) { return matcher.MatchScalar(n); });
+    double simd = Measure(names, rounds, simdMatches, [&](StringView n) { return matcher.Match(n); });
+
+
+    // scan: one name at a time from the buffer, as Platform::Scan did, strlen included; batch: the buffer's names at once
+    size_t scanMatches{}, batchMatches{};
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+    {
+      for (const Char* name : pointers) scanMatches += matcher.Match(StringView(name)) ? 1 : 0;
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    double scan = elapsed.count() / (static_cast<double>(names.size()) * rounds);
+    start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r) batchMatches += matcher.Match(pointers.data(), pointers.size(), flags.data());
+    elapsed = std::chrono::steady_clock::now() - start;
+    double batch = elapsed.count() / (static_cast<double>(names.size()) * rounds);
+
+    std::cout << (fold ? "ASCII folded" : "exact       ") << "  scalar " << scalar << "  simd " << simd << "  scan " << scan << "  batch " << batch
+              << "  speedup " << scalar / simd << "x, batch over scan " << scan / batch << "x";
+    if (scalarMatches != simdMatches || scalarMatches != scanMatches || scalarMatches != batchMatches) std::cout << "  MISMATCH";
+    std::cout << "  (" << scalarMatches / rounds << " matches)" << std::endl;
+  }
+
+  size_t platformMatches{};
+  double platform = Measure(names, rounds, platformMatches, [](StringView n) { return Engine::Platform::HasPrefix(n, IMG_TEXT("IMG_")); });
+  std::cout << "Platform::HasPrefix " << platform << std::endl;
+  return 0;
+}
@@ -0,0 +1,293 @@
+// TreeBench.cpp : generates a synthetic photo tree and times enumeration, matching, planning and renaming separately,
+// then the whole engine run with the chosen traversal options
+//
+
+#include <algorithm>        // For std::nth_element
+#include <chrono>
+#include <cstdio>           // For std::snprintf
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>           // For std::unique_ptr
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Engine.h"
+#include "Plan.h"
+#include "Platform.h"
+#include "Rules.h"
+
+using Engine::Char;
+using Engine::String;
+using Engine::StringView;
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+// what the generated tree looks like
+struct Shape
+{
+  unsigned depth{ 2 };                                   // levels of subdirectories below the root
+  unsigned fanout{ 4 };                                  // subdirectories per directory
+  unsigned files{ 500 };                                 // files per directory
+  double match{ 0.8 };                                   // share of the files with the prefix being renamed
+  unsigned length{ 12 };                                 // name length including the extension
+};
+
+// one timed phase; each latency sample is one op, what an op is depends on the phase
+struct Phase
+{
+  Phase(const char* name, const char* op) : name(name), op(op) {}
+
+  std::string name;
+  std::string op;
+  size_t files{};
+  double seconds{};
+  std::vector<double> latencies;                         // microseconds
+
+  double Percentile(double p)
+  {
+    if (latencies.empty()) return 0;
+    size_t k = static_cast<size_t>(p * static_cast<double>(latencies.size() - 1) + 0.5);
+    std::nth_element(latencies.begin(), latencies.begin() + static_cast<std::ptrdiff_t>(k), latencies.end());
+    return latencies[k];
+  }
+};
+
+static const StringView From{ IMG_TEXT("IMG_") };
+static const StringView To{ IMG_TEXT("BENCH_") };
+
+static double Micro(Clock::duration d)
+{
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+static String Name(StringView prefix, unsigned number, unsigned length)
+{
+  String digits = Engine::ToString(number);
+  size_t fixed = prefix.size() + 4;                      // prefix and ".JPG"
+  if (fixed + digits.size() < length) digits.insert(0, length - fixed - digits.size(), IMG_TEXT('0'));
+  return String(prefix) + digits + IMG_TEXT(".JPG");
+}
+
+// create the tree below root, breadth first; returns every directory, root first
+static std::vector<String> Generate(const String& root, const Shape& shape, size_t& files)
+{
+  static const StringView others[]{ IMG_TEXT("DSC_"), IMG_TEXT("PXL_"), IMG_TEXT("MVI_") };
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  std::vector<String> directories{ root };
+  std::vector<unsigned> levels{ 0 };
+  files = 0;
+  for (size_t d = 0; d < directories.size(); ++d)
+  {
+    fs::create_directories(fs::path(directories[d]));
+    for (unsigned i = 0; i < shape.files; ++i)
+    {
+      StringView prefix = coin(random) < shape.match ? From : others[random() % 3];
+      std::ofstream(fs::path(directories[d] + Engine::Separator + Name(prefix, i, shape.length)));
+      ++files;
+    }
+    if (levels[d] == shape.depth) continue;
+    for (unsigned i = 0; i < shape.fanout; ++i)
+    {
+      directories.push_back(directories[d] + Engine::Separator + IMG_TEXT("dir") + Engine::ToString(i));
+      levels.push_back(levels[d] + 1);
+    }
+  }
+  return directories;
+}
+
+static std::string Escape(const std::string& s)
+{
+  std::string out{};
+  for (char c : s)
+  {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+static int Usage()
+{
+  std::cerr << "usage: IMGRenameTreeBench [--root <dir>] [--depth <n>] [--fanout <n>] [--files <n>] [--match <0..1>]" << std::endl
+            << "       [--name-length <n>] [--rounds <n>] [-j|--threads <n>] [--pipeline] [--queue-depth <n>]" << std::endl
+            << "       [--json <file>|-] [--keep]" << std::endl
+            << "the tree goes to <root>/imgrename-bench; put root on tmpfs to time the engine rather than the disk" << std::endl;
+  return 2;
+}
+
+int main(int argc, char* argv[])
+{
+  Shape shape{};
+  unsigned rounds = 3;
+  bool keep = false;
+  std::string json{};
+  Engine::Options engine{};
+  fs::path base = fs::exists("/dev/shm") ? fs::path("/dev/shm") : fs::temp_directory_path();
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool value = i + 1 < argc;
+    if (arg == "--root" && value) base = argv[++i];
+    else if (arg == "--depth" && value) shape.depth = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (arg == "--fanout" && value) shape.fanout = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (arg == "--files" && value) shape.files = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (arg == "--match" && value) shape.match = std::stod(argv[++i]);
+    else if (arg == "--name-length" && value) shape.length = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (arg == "--rounds" && value) rounds = std::max(static_cast<unsigned>(std::stoul(argv[++i])), 1u);
+    else if ((arg == "-j" || arg == "--threads") && value) engine.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (arg == "--pipeline") engine.pipeline = true;
+    else if (arg == "--queue-depth" && value) engine.queueDepth = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (arg == "--json" && value) json = argv[++i];
+    else if (arg == "--keep") keep = true;
+    else return Usage();
+  }
+
+  fs::path tree = base / "imgrename-bench";
+  fs::remove_all(tree);
+  String root = tree.native();
+  size_t files = 0;
+  auto start = Clock::now();
+  std::vector<String> directories = Generate(root, shape, files);
+  std::cout << "generated " << directories.size() << " directories, " << files << " files in " << tree.string() << " ("
+            << Micro(Clock::now() - start) / 1e6 << " s)" << std::endl;
+
+  std::vector<Engine::Rule> rules{ Engine::Rule{ String(From), String(To) } };
+  Engine::RuleSet ruleSet(rules);
+  std::vector<Phase> phases{ Phase{ "enumerate", "directory" }, Phase{ "match", "256 names" }, Phase{ "plan", "directory" },
+                             Phase{ "rename", "file" }, Phase{ "engine", "run" } };
+  size_t failures = 0;
+  size_t matches = 0;
+
+  for (unsigned round = 0; round < rounds; ++round)
+  {
+    // enumerate: one Platform::Scan per directory, as the engine lists them
+    std::vector<std::unique_ptr<Engine::Listing>> listings{};
+    auto phaseStart = Clock::now();
+    for (const String& directory : directories)
+    {
+      auto listing = std::make_unique<Engine::Listing>();
+      auto t = Clock::now();
+      Engine::Platform::Scan(directory, ruleSet, false, *listing);
+      phases[0].latencies.push_back(Micro(Clock::now() - t));
+      phases[0].files += listing->files.size() + listing->others.size();
+      listings.push_back(std::move(listing));
+    }
+    phases[0].seconds += Micro(Clock::now() - phaseStart) / 1e6;
+
+    // match: every name through the rule set, in blocks so the clock doesn't dominate
+    phaseStart = Clock::now();
+    size_t matched = 0;
+    for (const auto& listing : listings)
+    {
+      for (const std::vector<StringView>* names : { &listing->files, &listing->others })
+      {
+        for (size_t begin = 0; begin < names->size(); begin += 256)
+        {
+          size_t end = std::min(begin + 256, names->size());
+          auto t = Clock::now();
+          for (size_t i = begin; i < end; ++i) matched += ruleSet.Match((*names)[i]) != nullptr ? 1 : 0;
+          phases[1].latencies.push_back(Micro(Clock::now() - t));
+        }
+        phases[1].files += names->size();
+      }
+    }
+    phases[1].seconds += Micro(Clock::now() - phaseStart) / 1e6;
+    matches += matched;
+    listings.clear();
+
+    // plan: the engine's BuildPlan one directory at a time, which lists the directory again and decides its renames
+    std::vector<std::unique_ptr<Engine::Plan>> plans{};
+    phaseStart = Clock::now();
+    for (const String& directory : directories)
+    {
+      Engine::Options options{};
+      options.path = directory;
+      options.from = String(From);
+      options.to = String(To);
+      Engine::Renamer renamer(options);
+      auto plan = std::make_unique<Engine::Plan>(16 * 1024);
+      auto t = Clock::now();
+      failures += renamer.BuildPlan(*plan).failures.size();
+      phases[2].latencies.push_back(Micro(Clock::now() - t));
+      phases[2].files += plan->Entries().size();
+      plans.push_back(std::move(plan));
+    }
+    phases[2].seconds += Micro(Clock::now() - phaseStart) / 1e6;
+
+    // rename: every planned rename, relative to its open directory, as Apply does without io_uring
+    phaseStart = Clock::now();
+    for (const auto& plan : plans)
+    {
+      if (plan->Entries().empty()) continue;
+      Engine::Directory dir;
+      dir.Open(String(plan->Directories()[0]));
+      for (const Engine::PlanEntry& entry : plan->Entries())
+      {
+        auto t = Clock::now();
+        try
+        {
+          dir.Rename(entry.from.data(), entry.to.data());
+        }
+        catch (const Engine::Error&)
+        {
+          ++failures;
+        }
+        phases[3].latencies.push_back(Micro(Clock::now() - t));
+        ++phases[3].files;
+      }
+    }
+    phases[3].seconds += Micro(Clock::now() - phaseStart) / 1e6;
+    plans.clear();
+
+    // engine: a full run over the tree with the traversal options given, renaming everything back for the next round
+    engine.path = root;
+    engine.from = String(To);
+    engine.to = String(From);
+    engine.subdir = true;
+    auto t = Clock::now();
+    Engine::Result result = Engine::Renamer(engine).Run();
+    phases[4].latencies.push_back(Micro(Clock::now() - t));
+    phases[4].seconds += phases[4].latencies.back() / 1e6;
+    phases[4].files += result.renamed;
+    failures += result.failures.size();
+  }
+
+  std::cout << rounds << " rounds, " << matches / rounds << " of " << files << " names matching, " << failures << " failures" << std::endl;
+  std::cout << "phase      op                ops   seconds     files/s    p50 us    p99 us" << std::endl;
+  std::string results{};
+  for (Phase& phase : phases)
+  {
+    double rate = phase.seconds > 0 ? static_cast<double>(phase.files) / phase.seconds : 0;
+    double p50 = phase.Percentile(0.5);
+    double p99 = phase.Percentile(0.99);
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-10s %-12s %9zu %9.3f %11.0f %9.2f %9.2f", phase.name.c_str(), phase.op.c_str(), phase.latencies.size(),
+      phase.seconds, rate, p50, p99);
+    std::cout << line << std::endl;
+    std::snprintf(line, sizeof(line), "%s\n    { \"phase\": \"%s\", \"op\": \"%s\", \"ops\": %zu, \"files\": %zu, \"seconds\": %.6f, "
+      "\"filesPerSecond\": %.1f, \"p50Us\": %.3f, \"p99Us\": %.3f }", results.empty() ? "" : ",", phase.name.c_str(), phase.op.c_str(),
+      phase.latencies.size(), phase.files, phase.seconds, rate, p50, p99);
+    results += line;
+  }
+
+  if (!json.empty())
+  {
+    // one object per benchmark run, stable keys, for scripts that compare runs
+    std::ofstream file{};
+    if (json != "-") file.open(json);
+    std::ostream& out = json == "-" ? std::cout : file;
+    out << "{\n  \"tree\": { \"root\": \"" << Escape(tree.u8string()) << "\", \"depth\": " << shape.depth << ", \"fanout\": " << shape.fanout
+        << ", \"filesPerDirectory\": " << shape.files << ", \"match\": " << shape.match << ", \"nameLength\": " << shape.length
+        << ", \"directories\": " << directories.size() << ", \"files\": " << files << " },\n"
+        << "  \"engine\": { \"threads\": " << engine.threads << ", \"pipeline\": " << (engine.pipeline ? "true" : "false")
+        << ", \"queueDepth\": " << engine.queueDepth << " },\n"
+        << "  \"rounds\": " << rounds << ",\n  \"failures\": " << failures << ",\n"
+        << "  \"phases\": [" << results << "\n  ]\n}" << std::endl;
+  }
+
+  if (!keep) fs::remove_all(tree);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+// IMGRenameCLI.cpp : headless front end for the rename engine
+//
+
+#include <atomic>
+#include <chrono>
+#include <climits>          // For UINT_MAX
+#include <csignal>          // For std::signal
+#include <cstdlib>          // For std::malloc, std::free
+#include <iomanip>          // For std::setw, std::setprecision
+#include <iostream>
+#include <new>              // For std::bad_alloc
+#include <string>
+#include <thread>
+
+#include "Engine.h"
+#include "Plan.h"
+#include "Progress.h"
+#include "Trace.h"
+#include "Watcher.h"
+
+#ifdef _WIN32
+#define IMG_MAIN wmain
+#define IMG_CERR std::wcerr
+#define IMG_COUT std::wcout
+#else
+#define IMG_MAIN main
+#define IMG_CERR std::cerr
+#define IMG_COUT std::cout
+#endif
+
+using Engine::Char;
+using Engine::String;
+
+// every heap allocation of the process is counted, so --stats can show that the per-file path doesn't allocate
+static std::atomic<size_t> allocations{};
+
+void* operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+static int Usage()
+{
+  std::cerr << "usage: IMGRenameCLI <path> [<from> <to>] [--rules <file>] [-s|--subdir] [-x|--one-file-system]" << std::endl
+            << "       [-j|--threads <n>] [-n|--dry-run] [-i|--ignore-case] [--match-case] [--on-collision abort|skip|suffix]" << std::endl
+            << "       [--sidecars] [--duplicates report|skip] [--folders <template>]" << std::endl
+            << "       [--journal <file>] [--index <file>] [-w|--watch [--latency <ms>]]" << std::endl
+            << "       [--cache <file> [--cache-limit <files>]] [--queue-depth <n>] [--stats]" << std::endl
+            << "       [--pipeline [--readers <n>] [--renamers <n>]] [--progress] [--trace <file>]" << std::endl
+            << "       [--adaptive] [--max-ops <per second>] [--streaming [--memory-limit <MB>]]" << std::endl
+            << "   or: IMGRenameCLI --undo <journal>" << std::endl
+            << "rules file: one \"<from> <to>\" pair per line, # starts a comment" << std::endl
+            << "<to> may contain EXIF fields: {DateTimeOriginal} {SubSecTime} {Model} {Year} {Month} {Day}" << std::endl
+            << "--folders moves files into folders named by such a template, e.g. {Year}/{Month}/{Day}, below <path> unless absolute" << std::endl;
+  return 2;
+}
+
+static void ReportDuplicates(const Engine::Result& result)
+{
+  for (const Engine::Duplicate& d : result.duplicates) IMG_COUT << d.path << IMG_TEXT(": copy of ") << d.original << IMG_TEXT('\n');
+  std::cout << result.duplicates.size() << " duplicates, " << std::fixed << std::setprecision(1) << static_cast<double>(result.compared) / (1024 * 1024)
+            << " MB read to find them" << std::endl;
+}
+
+static int Report(const Engine::Result& result)
+{
+  for (const Engine::Failure& f : result.failures)
+  {
+    IMG_CERR << f.path << IMG_TEXT(": ");
+    std::cerr << f.message << std::endl;
+  }
+  return result.failures.empty() ? 0 : 1;
+}
+
+static void ReportStages(const Engine::Result& result)
+{
+  std::cout << "stage      threads     dirs    files   busy s      files/s  queue max/mean" << std::endl;
+  for (const Engine::StageStats& s : result.stages)
+  {
+    double rate = s.busy > 0 ? static_cast<double>(s.files) / s.busy * s.threads : 0;   // with all its threads busy
+    std::cout << std::left << std::setw(10) << s.name << std::right << std::setw(8) << s.threads << std::setw(9) << s.directories
+              << std::setw(9) << s.files << std::fixed << std::setprecision(3) << std::setw(9) << s.busy << std::setprecision(0)
+              << std::setw(13) << rate;
+    if (s.queueMax > 0) std::cout << std::setw(9) << s.queueMax << " / " << std::setprecision(1) << s.queueMean;
+    std::cout << std::endl;
+  }
+  std::cout << std::setprecision(3) << result.seconds << " s wall clock" << std::endl;
+}
+
+static std::atomic<bool> stop{};
+static Engine::CancelToken cancel{};
+
+static void OnSignal(int)
+{
+  stop = true;
+  cancel.Cancel();
+}
+
+// one status line on stderr, rewritten twice a second until done is set
+static void ShowProgress(const Engine::Progress& progress, const std::atomic<bool>& done)
+{
+  for (unsigned tick = 1; !done; ++tick)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (tick % 5 != 0 && !done) continue;
+    std::cerr << "\r" << progress.directories << " directories, " << progress.matched << " files matched, " << progress.renamed << " renamed, "
+              << progress.failed << " failed, " << static_cast<unsigned long long>(progress.BytesPerSecond() / 1024) << " KB/s read   " << std::flush;
+  }
+  std::cerr << std::endl;
+}
+
+static String badNumber{};                               // the first option value Number() couldn't read
+
+// a whole decimal number, nothing before or after it; anything else is recorded in badNumber and reads as 0
+static unsigned Number(const String& arg)
+{
+  unsigned long long n = 0;
+  for (Char c : arg)
+  {
+    if (c < IMG_TEXT('0') || c > IMG_TEXT('9') || (n = n * 10 + static_cast<unsigned>(c - IMG_TEXT('0'))) > UINT_MAX)
+    {
+      n = UINT_MAX + 1ull;
+      break;
+    }
+  }
+  if (!arg.empty() && n <= UINT_MAX) return static_cast<unsigned>(n);
+  if (badNumber.empty()) badNumber = arg.empty() ? String(IMG_TEXT("\"\"")) : arg;
+  return 0;
+}
+
+int IMG_MAIN(int argc, Char* argv[])
+{
+  Engine::Options options{};
+  bool dryRun = false;
+  bool watch = false;
+  bool stats = false;
+  bool showProgress = false;
+  unsigned latency = 20;
+  String undo{};
+  String rules{};
+  String trace{};
+  int positional = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    String arg = argv[i];
+    if (arg == IMG_TEXT("-s") || arg == IMG_TEXT("--subdir")) options.subdir = true;
+    else if (arg == IMG_TEXT("-i") || arg == IMG_TEXT("--ignore-case")) options.ignoreCase = true;
+    else if (arg == IMG_TEXT("--match-case")) options.ignoreCase = false;
+    else if (arg == IMG_TEXT("--on-collision") && i + 1 < argc)
+    {
+      String policy = argv[++i];
+      if (policy == IMG_TEXT("abort")) options.collision = Engine::Collision::Abort;
+      else if (policy == IMG_TEXT("skip")) options.collision = Engine::Collision::Skip;
+      else if (policy == IMG_TEXT("suffix")) options.collision = Engine::Collision::Suffix;
+      else return Usage();
+    }
+    else if (arg == IMG_TEXT("--duplicates") && i + 1 < argc)
+    {
+      String policy = argv[++i];
+      if (policy == IMG_TEXT("report")) options.duplicates = Engine::Duplicates::Report;
+      else if (policy == IMG_TEXT("skip")) options.duplicates = Engine::Duplicates::Skip;
+      else return Usage();
+    }
+    else if (arg == IMG_TEXT("--rules") && i + 1 < argc) rules = argv[++i];
+    else if (arg == IMG_TEXT("--journal") && i + 1 < argc) options.journal = argv[++i];
+    else if (arg == IMG_TEXT("--index") && i + 1 < argc) options.index = argv[++i];
+    else if (arg == IMG_TEXT("--cache") && i + 1 < argc) options.cache = argv[++i];
+    else if (arg == IMG_TEXT("--cache-limit") && i + 1 < argc) options.cacheLimit = Number(argv[++i]);
+    else if (arg == IMG_TEXT("--undo") && i + 1 < argc) undo = argv[++i];
+    else if (arg == IMG_TEXT("-w") || arg == IMG_TEXT("--watch")) watch = true;
+    else if (arg == IMG_TEXT("--pipeline")) options.pipeline = true;
+    else if (arg == IMG_TEXT("--readers") && i + 1 < argc) options.readers = Number(argv[++i]);
+    else if (arg == IMG_TEXT("--renamers") && i + 1 < argc) options.renamers = Number(argv[++i]);
+    else if (arg == IMG_TEXT("--queue-depth") && i + 1 < argc) options.queueDepth = Number(argv[++i]);
+    else if (arg == IMG_TEXT("--latency") && i + 1 < argc) latency = Number(argv[++i]);
+    else if (arg == IMG_TEXT("-n") || arg == IMG_TEXT("--dry-run")) dryRun = true;
+    else if (arg == IMG_TEXT("--stats")) stats = true;
+    else if (arg == IMG_TEXT("--progress")) showProgress = true;
+    else if (arg == IMG_TEXT("--trace") && i + 1 < argc) trace = argv[++i];
+    else if (arg == IMG_TEXT("--adaptive")) options.adaptive = true;
+    else if (arg == IMG_TEXT("--sidecars")) options.sidecars = true;
+    else if (arg == IMG_TEXT("--folders") && i + 1 < argc) options.folders = argv[++i];
+    else if (arg == IMG_TEXT("-x") || arg == IMG_TEXT("--one-file-system")) options.oneFileSystem = true;
+    else if (arg == IMG_TEXT("--streaming")) options.streaming = true;
+    else if (arg == IMG_TEXT("--memory-limit") && i + 1 < argc) options.memoryLimit = static_cast<size_t>(Number(argv[++i])) * 1024 * 1024;
+    else if (arg == IMG_TEXT("--max-ops") && i + 1 < argc) options.opsPerSecond = Number(argv[++i]);
+    else if ((arg == IMG_TEXT("-j") || arg == IMG_TEXT("--threads")) && i + 1 < argc) options.threads = Number(argv[++i]);
+    else if (arg.size() > 1 && arg[0] == IMG_TEXT('-')) return Usage();
+    else if (positional == 0) { options.path = arg; ++positional; }
+    else if (positional == 1) { options.from = arg; ++positional; }
+    else if (positional == 2) { options.to = arg; ++positional; }
+    else return Usage();
+  }
+  if (!badNumber.empty())
+  {
+    IMG_CERR << IMG_TEXT("not a number: ") << badNumber << std::endl;
+    return Usage();
+  }
+  if (!undo.empty())
+  {
+    if (positional != 0) return Usage();
+    Engine::Result result = Engine::Renamer::Undo(undo);
+    std::cout << "reverted " << result.renamed << " renames" << std::endl;
+    return Report(result);
+  }
+  if (!rules.empty())
+  {
+    try
+    {
+      options.rules = Engine::LoadRules(rules);
+    }
+    catch (const Engine::Error& e)
+    {
+      IMG_CERR << e.Path() << IMG_TEXT(": ");
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  }
+  if (positional == 3 ? options.from.empty() : positional != 1 || options.rules.empty()) return Usage();
+
+  if (watch)
+  {
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    int status = 0;
+    try
+    {
+      Engine::Watcher(options, latency).Run(stop, [&status](const Engine::Result& result)
+        {
+          if (result.renamed > 0) std::cout << "renamed " << result.renamed << " files" << std::endl;
+          if (Report(result) != 0) status = 1;
+        });
+    }
+    catch (const Engine::Error& e)
+    {
+      IMG_CERR << e.Path() << IMG_TEXT(": ");
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+    return status;
+  }
+
+  // Ctrl+C stops at the next directory and still reports what was done
+  std::signal(SIGINT, OnSignal);
+  std::signal(SIGTERM, OnSignal);
+  Engine::Progress progress{};
+  options.progress = &progress;
+  options.cancel = &cancel;
+  std::atomic<bool> done{};
+  std::thread status{};
+  if (showProgress) status = std::thread(ShowProgress, std::cref(progress), std::cref(done));
+  auto finished = [&done, &status]
+    {
+      done = true;
+      if (status.joinable()) status.join();
+    };
+
+  Engine::Renamer renamer(options);
+  Engine::Result result{};
+  if (!trace.empty()) Engine::Tracer::Start();
+  size_t before = allocations.load();
+  if (dryRun)
+  {
+    Engine::Plan plan{};
+    result = renamer.BuildPlan(plan);
+    finished();
+    for (const Engine::PlanEntry& e : plan.Entries())
+    {
+      Engine::StringView dir = plan.Directories()[e.directory];
+      IMG_COUT << dir << Engine::Separator << e.from << IMG_TEXT(" -> ");
+      if (e.folder != Engine::Plan::InPlace) IMG_COUT << plan.Folders()[e.folder] << Engine::Separator;
+      IMG_COUT << e.to << IMG_TEXT('\n');
+    }
+    std::cout << "planned " << result.planned << " renames in " << result.directories << " directories" << std::endl;
+    if (options.duplicates != Engine::Duplicates::Ignore) ReportDuplicates(result);
+  }
+  else
+  {
+    result = renamer.Run();
+    finished();
+    std::cout << "renamed " << result.renamed << " files in " << result.directories << " directories";
+    if (result.resumed > 0) std::cout << " (" << result.resumed << " more finished before)";
+    if (result.unchanged > 0) std::cout << " (" << result.unchanged << " more unchanged)";
+    if (result.revisited > 0) std::cout << " (" << result.revisited << " reached twice through links)";
+    if (result.skipped > 0) std::cout << ", " << result.skipped << " already named right";
+    if (result.collisions > 0) std::cout << ", " << result.collisions << " name collisions";
+    if (result.cancelled) std::cout << ", cancelled";
+    std::cout << std::endl;
+    if (options.duplicates != Engine::Duplicates::Ignore) ReportDuplicates(result);
+    if (options.streaming) std::cout << "most memory one directory held: " << std::fixed << std::setprecision(1) << static_cast<double>(result.memoryPeak) / (1024 * 1024) << " MB" << std::endl;
+    if (options.adaptive) std::cout << "in flight at the end: " << result.listLimit << " listings, " << result.renameLimit << " renames" << std::endl;
+    if (!result.stages.empty()) ReportStages(result);
+  }
+  if (!trace.empty())
+  {
+    Engine::Tracer::Stop();
+    std::cout << Engine::Tracer::Summary();
+    try
+    {
+      Engine::Tracer::Write(trace);
+    }
+    catch (const Engine::Error& e)
+    {
+      result.failures.push_back(Engine::Failure{ e.Path(), e.what(), e.Code() });
+    }
+  }
+  if (stats)
+  {
+    size_t count = allocations.load() - before;
+    std::cout << count << " heap allocations for " << result.planned << " files in " << result.directories << " directories" << std::endl;
+  }
+  return Report(result);
+}
@@ -0,0 +1,41 @@
+#include <algorithm>        // For std::copy, std::max
+
+#include "Arena.h"
+
+namespace Engine
+{
+
+  Char* Arena::Allocate(size_t n)
+  {
+    if (n > m_left)
+    {
+      size_t size = std::max(n, m_chunk);              // oversized strings get a chunk of their own
+      m_chunks.push_back(std::make_unique<Char[]>(size));
+      m_cursor = m_chunks.back().get();
+      m_left = size;
+    }
+    Char* p = m_cursor;
+    m_cursor += n;
+    m_left -= n;
+    return p;
+  }
+
+  StringView Arena::Concat(StringView a, StringView b, StringView c)
+  {
+    size_t n = a.size() + b.size() + c.size();
+    Char* p = Allocate(n + 1);
+    Char* q = std::copy(a.begin(), a.end(), p);
+    q = std::copy(b.begin(), b.end(), q);
+    q = std::copy(c.begin(), c.end(), q);
+    *q = Char{};
+    return StringView(p, n);
+  }
+
+  void Arena::Clear()
+  {
+    if (m_chunks.size() > 1) m_chunks.resize(1);
+    m_cursor = m_chunks.empty() ? nullptr : m_chunks.front().get();
+    m_left = m_chunks.empty() ? 0 : m_chunk;
+  }
+
+}
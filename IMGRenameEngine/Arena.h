@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <memory>           // For std::unique_ptr
+#include <vector>
+
+#include "Common.h"
+
+namespace Engine
+{
+
+  // Bump allocator for strings that live as long as the arena: one heap allocation per chunk instead of one per string.
+  // Every stored string is NUL terminated, so data() can go straight to the OS.
+  class Arena
+  {
+  public:
+    explicit Arena(size_t chunk = 64 * 1024) : m_chunk(chunk) {}
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    StringView Store(StringView s) { return Concat(s, StringView{}); }
+    StringView Concat(StringView a, StringView b, StringView c = {});   // store a + b + c as one string
+    size_t Bytes() const { return m_chunks.size() * m_chunk * sizeof(Char); }   // memory held, for reporting
+    void Clear();                                        // forget all strings, keep the first chunk for reuse
+
+  private:
+    Char* Allocate(size_t n);
+
+  private:
+    size_t m_chunk;                                      // chunk size in characters
+    std::vector<std::unique_ptr<Char[]>> m_chunks;
+    Char* m_cursor{};
+    size_t m_left{};                                     // characters left in the current chunk
+  };
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdexcept>        // For std::runtime_error
+#include <string>           // For std::basic_string
+#include <string_view>      // For std::basic_string_view
+
+namespace Engine
+{
+
+#ifdef _WIN32
+  using Char = wchar_t;                                  // native path character
+#define IMG_TEXT(s) L##s
+  constexpr Char Separator{ L'\\' };
+#else
+  using Char = char;                                     // native path character
+#define IMG_TEXT(s) s
+  constexpr Char Separator{ '/' };
+#endif
+
+  using String = std::basic_string<Char>;
+  using StringView = std::basic_string_view<Char>;
+
+  template <typename T> String ToString(T n)
+  {
+#ifdef _WIN32
+    return std::to_wstring(n);
+#else
+    return std::to_string(n);
+#endif
+  }
+
+  // Exception class representing a failed file system operation
+  class Error : public std::runtime_error
+  {
+  public:
+    Error(const std::string& what, const String& path, int code) : std::runtime_error(what), m_path(path), m_code(code) {}
+    const String& Path() const { return m_path; }        // file or directory the operation failed on
+    int Code() const { return m_code; }                  // errno / GetLastError() value
+
+  private:
+    String m_path;
+    int m_code;
+  };
+
+}
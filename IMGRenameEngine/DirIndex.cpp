@@ -0,0 +1,164 @@
+#include <algorithm>        // For std::find
+#include <cstring>          // For memcpy()
+
+#include "DirIndex.h"
+
+namespace Engine
+{
+
+  // file layout: magic, then records of { signature, length of the strings in bytes, checksum, strings }, padded to 8
+  // bytes. The first record holds the key, later ones a directory path followed by its subdirectory names, each NUL
+  // terminated. The checksum covers the record with the checksum field zeroed, padding included.
+  static constexpr char Magic[8]{ 'I', 'M', 'G', 'I', 'D', 'X', '2', char('0' + sizeof(Char)) };
+
+  struct IndexRecord
+  {
+    Signature signature;
+    uint64_t length;
+    uint64_t checksum;
+  };
+
+  static inline size_t Align(size_t n) { return (n + 7) & ~size_t{ 7 }; }
+
+  static uint64_t Checksum(IndexRecord r, const char* strings, size_t size)   // FNV-1a over the record
+  {
+    r.checksum = 0;
+    uint64_t h = 14695981039346656037ull;
+    auto add = [&h](const char* data, size_t n)
+      {
+        for (size_t i = 0; i < n; ++i)
+        {
+          h ^= static_cast<unsigned char>(data[i]);
+          h *= 1099511628211ull;
+        }
+      };
+    add(reinterpret_cast<const char*>(&r), sizeof(r));
+    add(strings, size);
+    return h;
+  }
+
+  static size_t Length(const String& path, const std::vector<String>& names)
+  {
+    size_t length = path.size() + 1;
+    for (const String& name : names) length += name.size() + 1;
+    return length * sizeof(Char);
+  }
+
+  void DirIndex::Load(const String& file, const String& key)
+  {
+    m_file = file;
+    m_key = key;
+    m_old.clear();
+    if (!Platform::Exists(file)) return;
+
+    MappedFile f{};
+    try
+    {
+      f.Open(file, false);
+    }
+    catch (const Error&)
+    {
+      return;                                            // unreadable index: everything counts as changed
+    }
+    const char* data = f.Data();
+    size_t size = f.Size();
+    if (size < sizeof(Magic) || memcmp(data, Magic, sizeof(Magic)) != 0) return;
+
+    // a record that doesn't add up throws the whole index away: it is only a shortcut, a full listing is always right
+    std::unordered_map<String, Entry> loaded{};
+    bool first = true;
+    std::vector<String> strings{};
+    for (size_t pos = sizeof(Magic); pos < size;)
+    {
+      IndexRecord r{};
+      if (size - pos < sizeof(IndexRecord)) return;
+      memcpy(&r, data + pos, sizeof(r));
+      const char* body = data + pos + sizeof(IndexRecord);
+      size_t left = size - pos - sizeof(IndexRecord);
+      if (r.length == 0 || r.length % sizeof(Char) != 0 || r.length > left || Align(static_cast<size_t>(r.length)) > left) return;
+      size_t padded = Align(static_cast<size_t>(r.length));
+      if (Checksum(r, body, padded) != r.checksum) return;
+
+      // the strings end where the record does, whether or not the last one has its NUL
+      const Char* p = reinterpret_cast<const Char*>(body);
+      const Char* q = p + r.length / sizeof(Char);
+      strings.clear();
+      while (p < q)
+      {
+        const Char* nul = std::find(p, q, Char{});
+        strings.emplace_back(p, nul);
+        p = nul + 1;
+      }
+      pos += sizeof(IndexRecord) + padded;
+
+      if (first)
+      {
+        if (strings.size() != 1 || strings[0] != key) return;   // recorded with other parameters
+        first = false;
+        continue;
+      }
+      if (strings.empty()) return;
+      Entry& e = loaded[strings[0]];
+      e.signature = r.signature;
+      e.subdirs.assign(strings.begin() + 1, strings.end());
+    }
+    m_old = std::move(loaded);
+  }
+
+  void DirIndex::Save()
+  {
+    size_t size = sizeof(Magic) + sizeof(IndexRecord) + Align((m_key.size() + 1) * sizeof(Char));
+    for (const auto& d : m_new) size += sizeof(IndexRecord) + Align(Length(d.first, d.second.subdirs));
+
+    // write next to the old index and swap, so a crash never leaves a half-written index behind
+    String temp = m_file + IMG_TEXT(".tmp");
+    {
+      MappedFile f{};
+      f.Open(temp, true);
+      f.Resize(size);
+      char* p = f.Data();
+      memcpy(p, Magic, sizeof(Magic));
+      p += sizeof(Magic);
+
+      auto put = [&p](const Signature& signature, const String& first, const std::vector<String>& rest)
+        {
+          IndexRecord r{ signature, Length(first, rest), 0 };
+          char* s = p + sizeof(r);
+          memcpy(s, first.c_str(), (first.size() + 1) * sizeof(Char));
+          s += (first.size() + 1) * sizeof(Char);
+          for (const String& name : rest)
+          {
+            memcpy(s, name.c_str(), (name.size() + 1) * sizeof(Char));
+            s += (name.size() + 1) * sizeof(Char);
+          }
+          size_t used = sizeof(r) + static_cast<size_t>(r.length);
+          memset(s, 0, sizeof(r) + Align(static_cast<size_t>(r.length)) - used);
+          r.checksum = Checksum(r, p + sizeof(r), Align(static_cast<size_t>(r.length)));
+          memcpy(p, &r, sizeof(r));
+          p += sizeof(r) + Align(static_cast<size_t>(r.length));
+        };
+      put(Signature{}, m_key, {});
+      for (const auto& d : m_new) put(d.second.signature, d.first, d.second.subdirs);
+      f.Flush(true);
+    }
+    Platform::Replace(temp, m_file);
+  }
+
+  bool DirIndex::Unchanged(const String& directory, const Signature& signature, std::vector<String>& subdirs)
+  {
+    auto it = m_old.find(directory);
+    if (it == m_old.end() || !(it->second.signature == signature)) return false;
+    subdirs = it->second.subdirs;
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_new.emplace(directory, it->second);                // still settled, keep it for the next run
+    return true;
+  }
+
+  void DirIndex::Settled(const String& directory, const Signature& signature, const std::vector<String>& subdirs)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_new[directory] = Entry{ signature, subdirs };
+  }
+
+}
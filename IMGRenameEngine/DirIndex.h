@@ -0,0 +1,39 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Platform.h"
+
+namespace Engine
+{
+
+  // Persistent index of directory signatures from the last run. A directory whose signature hasn't changed since it was
+  // recorded as settled (nothing left to rename) is not listed again, its subdirectories are taken from the index.
+  // A parent's signature doesn't change when a grandchild does, so every directory is still stat'ed - but not listed.
+  class DirIndex
+  {
+  public:
+    void Load(const String& file, const String& key);    // key identifies the run parameters; a stale or missing index is simply empty
+    void Save();                                         // write the directories seen this run; throws Error
+
+    bool Unchanged(const String& directory, const Signature& signature, std::vector<String>& subdirs);   // if so, also keeps it for Save()
+    void Settled(const String& directory, const Signature& signature, const std::vector<String>& subdirs);   // thread safe
+
+  private:
+    struct Entry
+    {
+      Signature signature;
+      std::vector<String> subdirs;
+    };
+
+  private:
+    String m_file;
+    String m_key;
+    std::unordered_map<String, Entry> m_old;             // from the last run, read-only during this one
+    std::mutex m_lock;                                   // guards m_new
+    std::unordered_map<String, Entry> m_new;
+  };
+
+}
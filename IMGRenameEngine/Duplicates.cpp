@@ -0,0 +1,220 @@
+#include <algorithm>        // For std::sort, std::min
+#include <atomic>
+#include <cstring>          // For memcpy()
+#include <numeric>          // For std::iota
+#include <string>
+#include <tuple>            // For std::make_tuple
+#include <utility>          // For std::make_pair
+
+#include "Duplicates.h"
+#include "Platform.h"
+#include "Progress.h"
+#include "Trace.h"
+#include "WorkPool.h"
+
+namespace Engine
+{
+
+  static constexpr size_t Block = 4096;                  // read at each end of a file; the first one of a JPEG or raw file holds its EXIF data
+
+  static constexpr uint64_t Prime1 = 11400714785074694791ull;
+  static constexpr uint64_t Prime2 = 14029467366897019727ull;
+  static constexpr uint64_t Prime3 = 1609587929392839161ull;
+  static constexpr uint64_t Prime4 = 9650029242287828579ull;
+  static constexpr uint64_t Prime5 = 2870177450012600261ull;
+
+  static inline uint64_t Rotate(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+  static inline uint64_t Load64(const unsigned char* p) { uint64_t v; memcpy(&v, p, 8); return v; }   // little endian hosts only, as everywhere else
+  static inline uint64_t Load32(const unsigned char* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+  static inline uint64_t Round(uint64_t lane, uint64_t input) { return Rotate(lane + input * Prime2, 31) * Prime1; }
+  static inline uint64_t Merge(uint64_t h, uint64_t lane) { return (h ^ Round(0, lane)) * Prime1 + Prime4; }
+
+  uint64_t Hash64(const void* data, size_t size, uint64_t seed)
+  {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    uint64_t h{};
+    if (size >= 32)
+    {
+      // four lanes with no dependency between them: the CPU runs them side by side, compilers can vectorize them
+      uint64_t lane[4] = { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 };
+      for (; p + 32 <= end; p += 32)
+      {
+        for (int i = 0; i < 4; ++i) lane[i] = Round(lane[i], Load64(p + 8 * i));
+      }
+      h = Rotate(lane[0], 1) + Rotate(lane[1], 7) + Rotate(lane[2], 12) + Rotate(lane[3], 18);
+      for (int i = 0; i < 4; ++i) h = Merge(h, lane[i]);
+    }
+    else
+    {
+      h = seed + Prime5;
+    }
+    h += static_cast<uint64_t>(size);
+    for (; p + 8 <= end; p += 8) h = Rotate(h ^ Round(0, Load64(p)), 27) * Prime1 + Prime4;
+    if (p + 4 <= end)
+    {
+      h = Rotate(h ^ (Load32(p) * Prime1), 23) * Prime2 + Prime3;
+      p += 4;
+    }
+    for (; p < end; ++p) h = Rotate(h ^ (*p * Prime5), 11) * Prime1;
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+  }
+
+  // f(i) for every i in [0, count), in slices on pool if there is one
+  template <typename F> static void ForEach(WorkPool* pool, size_t count, F f)
+  {
+    static constexpr size_t Slice = 64;
+    if (pool == nullptr || count <= Slice)
+    {
+      for (size_t i = 0; i < count; ++i) f(i);
+      return;
+    }
+    for (size_t begin = 0; begin < count; begin += Slice)
+    {
+      size_t end = std::min(begin + Slice, count);
+      pool->Submit([&f, begin, end] { for (size_t i = begin; i < end; ++i) f(i); });
+    }
+    pool->Wait();
+  }
+
+  // calls same(first, i) for every candidate whose key equals that of an earlier one (first), after sorting by key
+  template <typename Key, typename Same> static void Runs(std::vector<size_t>& candidates, Key key, Same same)
+  {
+    std::sort(candidates.begin(), candidates.end(), [&key](size_t a, size_t b)
+      {
+        auto ka = key(a), kb = key(b);
+        return ka != kb ? ka < kb : a < b;               // lowest index first: the original is the first path
+      });
+    for (size_t i = 0; i < candidates.size();)
+    {
+      size_t last = i + 1;
+      while (last < candidates.size() && key(candidates[last]) == key(candidates[i])) ++last;
+      for (size_t k = i + 1; k < last; ++k) same(candidates[i], candidates[k]);
+      i = last;
+    }
+  }
+
+  std::vector<size_t> FindDuplicates(const std::vector<String>& paths, WorkPool* pool, const CancelToken* cancel, Progress* progress,
+    DuplicateStats& stats)
+  {
+    Span span("duplicates");
+    size_t count = paths.size();
+    std::vector<size_t> original(count);
+    std::iota(original.begin(), original.end(), 0);
+    stats.files += count;
+    auto cancelled = [cancel] { return cancel != nullptr && cancel->Cancelled(); };
+    std::atomic<uint64_t> bytes{};
+    auto read = [&](uint64_t n)
+      {
+        bytes += n;
+        if (progress) progress->bytes += n;
+      };
+
+    // 1. sizes, from stat alone
+    std::vector<FileId> ids(count);
+    std::vector<char> known(count);                      // not vector<bool>: written from several threads
+    ForEach(pool, count, [&](size_t i) { known[i] = !cancelled() && Platform::Identify(paths[i], ids[i]) && ids[i].size > 0; });
+
+    std::vector<size_t> candidates{};
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (known[i]) candidates.push_back(i);
+    }
+    std::vector<char> alike(count);                      // shares its key with another candidate at the current step
+    auto keep = [&candidates, &alike]
+      {
+        size_t n = 0;
+        for (size_t i : candidates)
+        {
+          if (alike[i]) candidates[n++] = i;
+          alike[i] = 0;
+        }
+        candidates.resize(n);
+      };
+
+    // hard links are settled here; of a size shared by no other file, nothing is read at all
+    Runs(candidates, [&ids](size_t i) { return std::make_pair(ids[i].device, ids[i].inode); }, [&](size_t first, size_t i)
+      {
+        original[i] = first;
+        ++stats.duplicates;
+      });
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&original](size_t i) { return original[i] != i; }), candidates.end());
+    Runs(candidates, [&ids](size_t i) { return ids[i].size; }, [&alike](size_t first, size_t i) { alike[first] = alike[i] = 1; });
+    keep();
+    stats.sized += candidates.size();
+
+    // 2. the first and last block; for a file of at most two blocks, that is all of it, and it is kept: equal hashes
+    // of two such files are settled by comparing their bytes, not taken on trust
+    std::vector<uint64_t> edges(count);
+    std::vector<size_t> unreadable(count);               // i + 1 for a file that couldn't be read: it matches no other
+    std::vector<std::string> whole(count);               // the content of a file of at most two blocks
+    ForEach(pool, candidates.size(), [&](size_t k)
+      {
+        if (cancelled()) return;
+        size_t i = candidates[k];
+        unsigned char buffer[2 * Block];
+        uint64_t size = ids[i].size;
+        bool small = size <= 2 * Block;
+        size_t want = small ? static_cast<size_t>(size) : 2 * Block;
+        size_t n = small ? Platform::ReadAt(paths[i], 0, buffer, want)
+          : Platform::ReadAt(paths[i], 0, buffer, Block) + Platform::ReadAt(paths[i], size - Block, buffer + Block, Block);
+        read(n);
+        if (n != want) unreadable[i] = i + 1;
+        else
+        {
+          edges[i] = Hash64(buffer, n, size);
+          if (small) whole[i].assign(reinterpret_cast<const char*>(buffer), n);
+        }
+      });
+    if (cancelled()) return original;
+    Runs(candidates, [&](size_t i) { return std::make_tuple(ids[i].size, unreadable[i], edges[i]); }, [&](size_t first, size_t i)
+      {
+        if (ids[i].size > 2 * Block) alike[first] = alike[i] = 1;
+        else if (whole[i] == whole[first])               // else a hash collision: taken for unique
+        {
+          original[i] = first;
+          ++stats.duplicates;
+        }
+      });
+    std::vector<std::string>().swap(whole);
+    keep();
+    stats.hashed += candidates.size();
+
+    // 3. everything, for the few still alike
+    std::vector<uint64_t> full(count);
+    ForEach(pool, candidates.size(), [&](size_t k)
+      {
+        if (cancelled()) return;
+        size_t i = candidates[k];
+        unreadable[i] = i + 1;
+        try
+        {
+          Span hashing("hash");
+          MappedFile file{};
+          file.Open(paths[i], false);
+          if (file.Size() != ids[i].size) return;        // changed since it was looked at
+          full[i] = Hash64(file.Data(), file.Size(), ids[i].size);
+          unreadable[i] = 0;
+          read(file.Size());
+        }
+        catch (const Error&)
+        {
+        }
+      });
+    if (cancelled()) return original;
+    Runs(candidates, [&](size_t i) { return std::make_tuple(ids[i].size, edges[i], unreadable[i], full[i]); }, [&](size_t first, size_t i)
+      {
+        original[i] = first;
+        ++stats.duplicates;
+      });
+
+    stats.bytes += bytes;
+    return original;
+  }
+
+}
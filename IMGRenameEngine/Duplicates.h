@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint64_t
+#include <vector>
+
+#include "Common.h"
+
+namespace Engine
+{
+
+  class CancelToken;
+  struct Progress;
+  class WorkPool;
+
+  struct DuplicateStats
+  {
+    size_t files{};                                      // files looked at
+    size_t sized{};                                      // files sharing their size with another one: the only ones read at all
+    size_t hashed{};                                     // files whose first and last blocks matched another's, read in full
+    size_t duplicates{};                                 // files with the same content as an earlier one
+    uint64_t bytes{};                                    // read, in total
+  };
+
+  // Finds files with the same content while reading as little of them as possible. Files are bucketed by size (stat
+  // only), files sharing a size are told apart by a hash of their first and last blocks, and only the ones still
+  // alike after that are hashed in full; a file of two blocks or less has been read whole by then, and is compared. Hard links to one file are the same content without reading anything.
+  // On a photo archive almost every file is settled by its size or by its first block, which holds the EXIF
+  // timestamp; only real copies are read to the end. Hashing runs on pool, if given.
+  //
+  // Returns, for every path, the index of the first path with the same content: its own index if there is none.
+  // Files that can't be read are taken for unique.
+  std::vector<size_t> FindDuplicates(const std::vector<String>& paths, WorkPool* pool, const CancelToken* cancel, Progress* progress,
+    DuplicateStats& stats);
+
+  uint64_t Hash64(const void* data, size_t size, uint64_t seed);   // XXH64: four independent lanes, several GB/s per core
+
+}
@@ -0,0 +1,1023 @@
+#include <algorithm>        // For std::sort, std::max, std::count
+#include <cerrno>           // For EINVAL
+#include <memory>           // For std::unique_ptr
+#include <system_error>     // For std::generic_category
+#include <thread>           // For std::thread::hardware_concurrency
+#include <utility>          // For std::pair
+
+#include "DirIndex.h"
+#include "Duplicates.h"
+#include "Engine.h"
+#include "Exif.h"
+#include "Folders.h"
+#include "Journal.h"
+#include "MetaCache.h"
+#include "NameSet.h"
+#include "Pipeline.h"
+#include "Plan.h"
+#include "Platform.h"
+#include "Progress.h"
+#include "Throttle.h"
+#include "Trace.h"
+#include "Traversal.h"
+#include "Uring.h"
+#include "WorkPool.h"
+
+namespace Engine
+{
+
+  Renamer::Renamer(const Options& options) : m_options(options), m_folder(options.folders)
+  {
+    // strip a trailing separator, so "C:\" and "C:" produce the same paths
+    while (m_options.path.size() > 1 && (m_options.path.back() == IMG_TEXT('/') || m_options.path.back() == IMG_TEXT('\\')))
+      m_options.path.pop_back();
+    // the journal records folders below it, and its undo may run from another directory
+    m_options.path = Platform::FullPath(m_options.path);
+
+    std::vector<Rule> rules{};
+    if (!m_options.from.empty()) rules.push_back(Rule{ m_options.from, m_options.to });
+    rules.insert(rules.end(), m_options.rules.begin(), m_options.rules.end());
+    m_rules = RuleSet(rules);
+    for (const Rule& rule : m_rules.Rules()) m_templates.emplace_back(rule.to);
+    if (!m_options.folders.empty()) m_folders = std::make_unique<Folders>(m_options.ignoreCase);
+
+    if (m_options.adaptive || m_options.opsPerSecond > 0)
+    {
+      // the controller can't go above what the threads (and io_uring queues) can have in flight
+      unsigned threads = m_options.threads != 0 ? m_options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+      unsigned renamers = m_options.pipeline ? m_options.renamers : threads;
+      if (m_options.opsPerSecond > 0) m_rate = std::make_unique<RateLimit>(m_options.opsPerSecond);
+      m_listings = std::make_unique<Throttle>(m_options.subdir ? threads : 1, m_options.adaptive, m_rate.get());
+      m_renames = std::make_unique<Throttle>(renamers * std::max(m_options.queueDepth, 1u), m_options.adaptive, m_rate.get());
+    }
+  }
+
+  Renamer::~Renamer() = default;
+
+  Result Renamer::BuildPlan(Plan& plan)
+  {
+    m_traversal = std::make_unique<Traversal>(m_options.oneFileSystem);
+    if (m_options.threads == 1 || !m_options.subdir)
+    {
+      String path{};
+      m_traversal->Push(m_options.path);
+      while (m_traversal->Pop(path)) ScanDirectory(path, plan, nullptr);
+    }
+    else
+    {
+      WorkPool pool(m_options.threads);
+      pool.Submit([this, &plan, &pool] { ScanDirectory(m_options.path, plan, &pool); });
+      pool.Wait();
+    }
+    plan.Sort();
+    Result result = Collect();
+    if (m_options.duplicates != Duplicates::Ignore && !Cancelled()) FindCopies(plan, result);
+    return result;
+  }
+
+  void Renamer::FindCopies(Plan& plan, Result& result)
+  {
+    const std::vector<PlanEntry>& entries = plan.Entries();
+    std::vector<String> paths{};
+    paths.reserve(entries.size());
+    for (const PlanEntry& e : entries) paths.push_back(String(plan.Directories()[e.directory]).append(1, Separator).append(e.from));
+
+    std::unique_ptr<WorkPool> pool{};
+    if (m_options.threads != 1) pool = std::make_unique<WorkPool>(m_options.threads);
+    DuplicateStats stats{};
+    std::vector<size_t> original = FindDuplicates(paths, pool.get(), m_options.cancel, m_options.progress, stats);
+    result.compared = stats.bytes;
+
+    std::vector<char> drop(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+      if (original[i] == i) continue;
+      result.duplicates.push_back(Duplicate{ paths[i], paths[original[i]] });
+      drop[i] = 1;
+    }
+    std::sort(result.duplicates.begin(), result.duplicates.end(), [](const Duplicate& a, const Duplicate& b) { return a.path < b.path; });
+    if (m_options.duplicates != Duplicates::Skip || result.duplicates.empty()) return;
+
+    // a group is renamed all or none, so a copy keeps its whole group back
+    for (size_t begin = 0; begin < entries.size();)
+    {
+      size_t end = begin + 1;
+      bool copy = drop[begin] != 0;
+      while (end < entries.size() && entries[end].directory == entries[begin].directory && entries[end].group == entries[begin].group) copy |= drop[end++] != 0;
+      for (size_t i = begin; copy && i < end; ++i) drop[i] = 1;
+      begin = end;
+    }
+    size_t dropped = static_cast<size_t>(std::count(drop.begin(), drop.end(), 1));
+    plan.Remove(drop);
+    result.planned -= dropped;
+    if (m_options.progress) m_options.progress->matched -= dropped;
+  }
+
+  Result Renamer::Apply(const Plan& plan)
+  {
+    const std::vector<PlanEntry>& entries = plan.Entries();
+    WorkPool* pool{};
+    std::unique_ptr<WorkPool> owner{};
+    if (m_options.threads != 1 && plan.Directories().size() > 1)
+    {
+      owner = std::make_unique<WorkPool>(m_options.threads);
+      pool = owner.get();
+    }
+
+    // the plan is sorted, so each directory's entries are one contiguous range
+    for (size_t begin = 0; begin < entries.size();)
+    {
+      size_t end = begin + 1;
+      while (end < entries.size() && entries[end].directory == entries[begin].directory) ++end;
+      if (pool == nullptr) ApplyDirectory(plan, begin, end);
+      else pool->Submit([this, &plan, begin, end] { ApplyDirectory(plan, begin, end); });
+      begin = end;
+    }
+    if (pool != nullptr) pool->Wait();
+    return Collect();
+  }
+
+  Result Renamer::Run()
+  {
+    if (!m_options.journal.empty())
+    {
+      m_journal = std::make_unique<Journal>();
+      try
+      {
+        m_journal->Open(m_options.journal, m_options.path, m_rules.Key());
+      }
+      catch (const Error& e)
+      {
+        m_journal.reset();
+        Fail(e);
+        return Collect();
+      }
+    }
+
+    if (!m_options.index.empty())
+    {
+      // the index is only valid for the parameters it was built with
+      String key = m_options.path + IMG_TEXT('\n') + m_rules.Key() +
+        ToString(static_cast<int>(m_options.subdir)) + ToString(static_cast<int>(m_options.ignoreCase)) + ToString(static_cast<int>(m_options.collision)) + m_options.folders;
+      m_index = std::make_unique<DirIndex>();
+      m_index->Load(m_options.index, key);
+    }
+
+    if (!m_options.cache.empty())
+    {
+      m_cache = std::make_unique<MetaCache>();
+      try
+      {
+        m_cache->Open(m_options.cache, m_options.cacheLimit);
+      }
+      catch (const Error& e)
+      {
+        m_cache.reset();                                 // run without it
+        Fail(e);
+      }
+    }
+
+    Result result{};
+    if (m_options.streaming)
+    {
+      Plan plan{ 16 * 1024 };                            // stays empty: the traversal of BuildPlan renames every directory as it reads it
+      m_streaming = true;
+      result = BuildPlan(plan);
+      m_streaming = false;
+    }
+    else if (m_options.pipeline && m_options.duplicates == Duplicates::Ignore)   // copies are only known once the whole plan is
+    {
+      result = RunPipeline();
+    }
+    else
+    {
+      Plan plan{};
+      result = BuildPlan(plan);
+      Result applied = Apply(plan);
+      result.renamed = applied.renamed;
+      result.skipped = applied.skipped;
+      result.collisions += applied.collisions;
+      result.cancelled = applied.cancelled;
+      result.renameLimit = applied.renameLimit;         // the plan is made before the first rename
+      result.failures.insert(result.failures.end(), applied.failures.begin(), applied.failures.end());
+    }
+    m_journal.reset();
+    if (m_cache)
+    {
+      try
+      {
+        m_cache->Close();
+      }
+      catch (const Error& e)
+      {
+        result.failures.push_back(Failure{ e.Path(), e.what(), e.Code() });
+      }
+      m_cache.reset();
+    }
+    if (m_index)
+    {
+      try
+      {
+        m_index->Save();
+      }
+      catch (const Error& e)
+      {
+        result.failures.push_back(Failure{ e.Path(), e.what(), e.Code() });
+      }
+      m_index.reset();
+    }
+
+    std::sort(result.failures.begin(), result.failures.end(), [](const Failure& a, const Failure& b) { return a.path < b.path; });
+    return result;
+  }
+
+  Result Renamer::Collect()
+  {
+    Result result{};
+    result.directories = m_directories.exchange(0);
+    result.resumed = m_resumed.exchange(0);
+    result.unchanged = m_unchanged.exchange(0);
+    result.planned = m_planned.exchange(0);
+    result.renamed = m_renamed.exchange(0);
+    result.skipped = m_skipped.exchange(0);
+    result.collisions = m_collisions.exchange(0);
+    result.memoryPeak = m_memoryPeak.exchange(0);
+    if (m_traversal) result.revisited = m_traversal->Revisits();
+    m_traversal.reset();                                 // the walk is over once its results are out
+    result.cancelled = Cancelled();
+    if (m_options.adaptive)
+    {
+      result.listLimit = m_listings->Limit();
+      result.renameLimit = m_renames->Limit();
+    }
+    result.failures = std::move(m_failures);
+    m_failures.clear();
+    // traversal order depends on thread timing, the report must not
+    std::sort(result.failures.begin(), result.failures.end(), [](const Failure& a, const Failure& b) { return a.path < b.path; });
+    return result;
+  }
+
+  void Renamer::Fail(const Error& e)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_failures.push_back(Failure{ e.Path(), e.what(), e.Code() });
+    if (m_options.progress) ++m_options.progress->failed;
+  }
+
+  void Renamer::Renamed()
+  {
+    ++m_renamed;
+    if (m_options.progress) ++m_options.progress->renamed;
+  }
+
+  void Renamer::Unrenamed()
+  {
+    --m_renamed;
+    if (m_options.progress) --m_options.progress->renamed;
+  }
+
+  bool Renamer::Cancelled() const
+  {
+    return m_options.cancel && m_options.cancel->Cancelled();
+  }
+
+  static bool Absolute(StringView path)
+  {
+    if (!path.empty() && (path[0] == IMG_TEXT('/') || path[0] == IMG_TEXT('\\'))) return true;
+#ifdef _WIN32
+    if (path.size() > 1 && path[1] == IMG_TEXT(':')) return true;
+#endif
+    return false;
+  }
+
+  // full path of an expanded Options::folders template: as it is if absolute, else below the root
+  String Renamer::FolderPath(StringView folder) const
+  {
+    String path{};
+    if (!Absolute(folder)) path.assign(m_options.path).append(1, Separator);
+    path.append(folder);
+    for (Char& c : path)
+    {
+      if (c == IMG_TEXT('/')) c = Separator;
+    }
+    while (path.size() > 1 && path.back() == Separator) path.pop_back();
+    return path;
+  }
+
+  Result Renamer::Undo(const String& journal)
+  {
+    Renamer undo{ Options{} };
+    Journal j{};
+    try
+    {
+      j.Open(journal);
+    }
+    catch (const Error& e)
+    {
+      undo.Fail(e);
+      return undo.Collect();
+    }
+
+    std::vector<Journal::Rename> renames = j.Renames();
+    for (auto it = renames.rbegin(); it != renames.rend(); ++it)
+    {
+      String from = Absolute(it->to) ? it->to : it->directory + Separator + it->to;   // moved into a folder: a full path
+      String to = it->directory + Separator + it->from;
+      try
+      {
+        Platform::Move(from, to);
+        ++undo.m_renamed;
+      }
+      catch (const Error& e)
+      {
+        // the journal is written ahead of the rename; a crash in between leaves a record for a rename that never happened
+        if (Platform::Exists(from) || !Platform::Exists(to))
+        {
+          undo.Fail(e);
+          continue;
+        }
+      }
+      j.Undone(*it);
+    }
+    return undo.Collect();
+  }
+
+  void Renamer::ScanDirectory(const String& path, Plan& plan, WorkPool* pool)
+  {
+    if (Cancelled()) return;                             // the directories still queued in the pool drain right here
+    Signature signature{};
+    bool known = (m_index || m_options.subdir) && Platform::Stat(path, signature);   // stat before listing: a change in between makes the next run look again
+    if (known && m_options.subdir && !m_traversal->Enter(signature)) return;   // reached through a link or mount before, or on another file system
+
+    Listing listing{};
+    if (m_journal && m_journal->Finished(path, listing.subdirs))   // finished before a crash: only its subdirectories are of interest
+    {
+      ++m_resumed;
+      if (m_options.subdir) Descend(path, listing.subdirs, plan, pool);
+      return;
+    }
+
+    bool indexed = m_index && known;
+    if (indexed && m_index->Unchanged(path, signature, listing.subdirs))
+    {
+      ++m_unchanged;
+      if (m_options.subdir) Descend(path, listing.subdirs, plan, pool);
+      return;
+    }
+
+    if (m_streaming)
+    {
+      StreamDirectory(path, listing, signature, indexed, plan, pool);
+      return;
+    }
+
+    // one enumeration per directory yields both the rename candidates and the subdirectories
+    Pipeline::Clock::time_point started = Pipeline::Clock::now();
+    try
+    {
+      Span span("list");
+      Throttle::Slot slot(m_listings.get());
+      Platform::Scan(path, m_rules, m_options.subdir, listing);
+    }
+    catch (const Error& e)
+    {
+      Fail(e);
+      return;
+    }
+    ++m_directories;
+    if (m_options.progress) ++m_options.progress->directories;
+    std::sort(listing.files.begin(), listing.files.end());   // suffixes must not depend on enumeration order
+    if (m_pipeline != nullptr)
+    {
+      Descend(path, listing.subdirs, plan, pool);        // subdirectories first: they are enumerated while this one goes down the pipeline
+      m_pipeline->Enumerated(path, std::move(listing), signature, indexed, started);
+      return;
+    }
+    if (PlanDirectory(path, listing, plan, nullptr) && indexed) Settle(path, listing, signature);
+    Descend(path, listing.subdirs, plan, pool);
+  }
+
+  void Renamer::Settle(const String& path, const Listing& listing, Signature signature)
+  {
+    // only directories without work are recorded; renaming changes the signature, so renamed ones are listed once more next time
+    signature.entries = listing.files.size() + listing.subdirs.size() + listing.others.size();
+    m_index->Settled(path, signature, listing.subdirs);
+  }
+
+  void Renamer::Descend(const String& path, const std::vector<String>& subdirs, Plan& plan, WorkPool* pool)
+  {
+    if (pool == nullptr)
+    {
+      // onto the stack BuildPlan walks, last one first: they come off in listing order, each with its subtree
+      for (auto it = subdirs.rbegin(); it != subdirs.rend(); ++it) m_traversal->Push(path, *it);
+      return;
+    }
+    for (const String& name : subdirs)
+    {
+      String subdir = path + Separator + name;
+      pool->Submit([this, &plan, pool, subdir] { ScanDirectory(subdir, plan, pool); });
+    }
+  }
+
+  Result Renamer::RenameFiles(const String& directory, const std::vector<String>& names)
+  {
+    Listing listing{};
+    listing.partial = true;
+    for (const String& name : names)
+    {
+      if (m_rules.Match(name) != nullptr && Platform::Exists(directory + Separator + name)) listing.files.push_back(listing.names.Store(name));
+    }
+    std::sort(listing.files.begin(), listing.files.end());
+    listing.files.erase(std::unique(listing.files.begin(), listing.files.end()), listing.files.end());
+
+    Plan plan{};
+    if (!listing.files.empty()) PlanDirectory(directory, listing, plan, nullptr);
+    return Apply(plan);
+  }
+
+  // "_<n>" written backwards into buffer, without a temporary string
+  static StringView Counter(unsigned n, Char (&buffer)[16])
+  {
+    Char* p = buffer + 16;
+    do *--p = static_cast<Char>(IMG_TEXT('0') + n % 10); while ((n /= 10) != 0);
+    *--p = IMG_TEXT('_');
+    return StringView(p, static_cast<size_t>(buffer + 16 - p));
+  }
+
+  // name with "_<n>" before its extension: "6D-041.JPG" -> "6D-041_1.JPG"; with stem, before the first dot instead of
+  // the last, so a sidecar keeps the name of its raw file: "6D-041.CR2.xmp" -> "6D-041_1.CR2.xmp"
+  static StringView Numbered(StringView name, unsigned n, bool stem, Plan::Batch& batch)
+  {
+    size_t dot = stem ? name.find(IMG_TEXT('.'), 1) : name.rfind(IMG_TEXT('.'));
+    if (dot == StringView::npos || dot == 0) dot = name.size();
+    Char buffer[16];
+    return batch.Name(name.substr(0, dot), Counter(n, buffer), name.substr(dot));
+  }
+
+  // the same with the last dot, into a string that is reused: for the attempts that are thrown away, nothing is stored
+  static StringView Numbered(StringView name, unsigned n, String& out)
+  {
+    size_t dot = name.rfind(IMG_TEXT('.'));
+    if (dot == StringView::npos || dot == 0) dot = name.size();
+    Char buffer[16];
+    out.assign(name.substr(0, dot)).append(Counter(n, buffer)).append(name.substr(dot));
+    return out;
+  }
+
+  // "IMG_1234" of IMG_1234.CR2, IMG_1234.JPG and IMG_1234.CR2.xmp: what a raw file and its sidecars have in common
+  static StringView Stem(StringView name)
+  {
+    size_t dot = name.find(IMG_TEXT('.'), 1);
+    return dot == StringView::npos ? name : name.substr(0, dot);
+  }
+
+  bool Renamer::NeedsMetadata(StringView name) const
+  {
+    const Rule* rule = m_rules.Match(name);
+    return rule != nullptr && (!m_folder.Plain() || !m_templates[static_cast<size_t>(rule - m_rules.Rules().data())].Plain());
+  }
+
+  void Renamer::ReadMetadata(const String& file, Exif& exif)
+  {
+    Span span("exif");
+    FileId id{};
+    bool cached = m_cache && Platform::Identify(file, id);
+    if (cached && m_cache->Find(id, exif)) return;
+    size_t bytes = 0;
+    exif.Read(file, &bytes);                             // only the first few KB of the file
+    if (m_options.progress) m_options.progress->bytes += bytes;
+    if (!cached) return;
+    try
+    {
+      m_cache->Store(id, exif);
+    }
+    catch (const Error& e)
+    {
+      Fail(e);                                           // the cache gives up, the run carries on
+    }
+  }
+
+  // listing.files must be sorted; metadata, if given, holds the EXIF fields of the files that need them, parallel to listing.files
+  bool Renamer::PlanDirectory(const String& path, const Listing& listing, Plan& plan, const std::vector<Exif>* metadata)
+  {
+    Span span("plan");
+    // every name in the directory plus every name already promised to a rename; O(1) per check
+    NameSet taken(m_options.ignoreCase);
+    taken.Reserve(listing.files.size() * 2 + listing.subdirs.size() + listing.others.size());
+    for (StringView name : listing.files) taken.Insert(name);
+    for (const String& name : listing.subdirs) taken.Insert(name);
+    for (StringView name : listing.others) taken.Insert(name);
+
+    // names that only match because an interrupted run already renamed them (when the new prefix starts with the old one)
+    NameSet renamed(m_options.ignoreCase);
+    if (const std::vector<String>* targets = m_journal ? m_journal->Targets(path) : nullptr)
+    {
+      for (const String& name : *targets) renamed.Insert(name);
+    }
+
+    // is a new name still free; on a partial listing the disk has the final word
+    String scratch{};
+    auto available = [&](StringView to, StringView name)
+      {
+        if (taken.Same(to, name)) return true;           // a pure case change is not a collision
+        if (taken.Contains(to)) return false;
+        if (!listing.partial) return true;
+        scratch.assign(path).append(1, Separator).append(to);   // reused, so no allocation per name once it is long enough
+        return !Platform::Exists(scratch);
+      };
+    auto load = [&](size_t i, Exif& exif)
+      {
+        if (metadata != nullptr) exif = (*metadata)[i];
+        else ReadMetadata(scratch.assign(path).append(1, Separator).append(listing.files[i]), exif);
+      };
+
+    // groups of files renamed all or none, numbered in name order. With sidecars, the files sharing a stem (IMG_1234.CR2,
+    // .JPG, .xmp) are one group, found with one hash map lookup per name; without, every file is a group of its own.
+    size_t files = listing.files.size();
+    std::vector<uint32_t> group(files);
+    uint32_t groups = 0;
+    NameSet stems(m_options.ignoreCase);
+    if (m_options.sidecars) stems.Reserve(files);
+    for (size_t i = 0; i < files; ++i)
+    {
+      group[i] = m_options.sidecars ? stems.Emplace(Stem(listing.files[i]), groups) : groups;
+      if (group[i] == groups) ++groups;
+    }
+    std::vector<uint32_t> start(groups + 1);             // members of group g: members[start[g]] .. members[start[g + 1] - 1]
+    for (uint32_t g : group) ++start[g + 1];
+    for (uint32_t g = 0; g < groups; ++g) start[g + 1] += start[g];
+    std::vector<uint32_t> members(files);
+    std::vector<uint32_t> next(start.begin(), start.end() - 1);
+    for (size_t i = 0; i < files; ++i) members[next[group[i]]++] = static_cast<uint32_t>(i);
+
+    Plan::Batch batch{};
+    std::vector<StringView> names{};                     // the group being planned, and its new names
+    std::vector<StringView> tos{};
+    std::vector<StringView> shared{};                    // the new names claimed in m_folders as well
+    std::vector<std::pair<String, std::vector<StringView>>> claims{};   // everything claimed in m_folders so far, to give back on Abort
+    String folder{};
+    Exif exif{};
+    for (uint32_t g = 0; g < groups; ++g)
+    {
+      names.clear();
+      for (uint32_t k = start[g]; k < start[g + 1]; ++k)
+      {
+        StringView name = listing.files[members[k]];
+        if (renamed.Size() == 0 || !renamed.Contains(name)) names.push_back(name);
+      }
+      if (names.empty()) continue;
+
+      // with EXIF fields in the new names or the folder, the first member that has them dates the whole group:
+      // an XMP sidecar, or a raw file the EXIF reader can't parse, takes the fields of its JPEG
+      Char prefix[256];
+      bool dated = false;
+      for (uint32_t k = start[g]; k < start[g + 1] && !dated; ++k)
+      {
+        StringView name = listing.files[members[k]];
+        const Rule* rule = m_rules.Match(name);          // one walk down the trie, whatever the number of rules
+        const NameTemplate& pattern = m_templates[static_cast<size_t>(rule - m_rules.Rules().data())];
+        if ((pattern.Plain() && m_folder.Plain()) || (renamed.Size() > 0 && renamed.Contains(name))) continue;
+        exif = Exif{};
+        load(members[k], exif);
+        dated = (pattern.Plain() || pattern.Expand(exif, prefix, 256) != static_cast<size_t>(-1)) &&
+          (m_folder.Plain() || m_folder.Expand(exif, prefix, 256) != static_cast<size_t>(-1));
+      }
+
+      tos.clear();
+      for (StringView name : names)
+      {
+        const Rule* rule = m_rules.Match(name);
+        const NameTemplate& pattern = m_templates[static_cast<size_t>(rule - m_rules.Rules().data())];
+        size_t n = 0;
+        if (pattern.Plain()) tos.push_back(batch.Name(rule->to, name.substr(rule->from.size())));
+        else if (dated && (n = pattern.Expand(exif, prefix, 256)) != static_cast<size_t>(-1)) tos.push_back(batch.Name(StringView(prefix, n), name.substr(rule->from.size())));
+        else
+        {
+          Fail(Error("no EXIF data for the new name", path + Separator + String(name), 0));
+          break;
+        }
+      }
+      if (tos.size() != names.size()) continue;
+
+      // where the group goes when the run reorganises; the folder it is in already is no move at all
+      folder.clear();
+      if (m_folders)
+      {
+        Char buffer[512];
+        size_t n = m_folder.Plain() || dated ? m_folder.Expand(exif, buffer, 512) : static_cast<size_t>(-1);
+        if (n == static_cast<size_t>(-1))
+        {
+          Fail(Error("no EXIF data for the folder", path + Separator + String(names[0]), 0));
+          continue;
+        }
+        folder = FolderPath(StringView(buffer, n));
+        if (folder == path) folder.clear();
+      }
+
+      // how many of the new names are taken, in this directory or in the folder; none: they are all claimed.
+      // When the run reorganises, this directory may be the folder of files from elsewhere as well: names given out
+      // in place are claimed there too, so both kinds of rename see each other's
+      auto claim = [&]() -> size_t
+        {
+          if (!folder.empty())
+          {
+            size_t busy = m_folders->Claim(folder, tos);
+            if (busy == 0 && m_options.collision == Collision::Abort) claims.emplace_back(folder, tos);
+            return busy;
+          }
+          size_t busy = 0;
+          for (size_t k = 0; k < names.size(); ++k) busy += !available(tos[k], names[k]);
+          if (busy == 0 && m_folders)
+          {
+            shared.clear();
+            for (size_t k = 0; k < names.size(); ++k)
+            {
+              if (!taken.Same(tos[k], names[k])) shared.push_back(tos[k]);   // a case change keeps its own place
+            }
+            busy = m_folders->Claim(path, shared, &listing);   // the first claim here takes the names from the listing
+            if (busy == 0 && m_options.collision == Collision::Abort) claims.emplace_back(path, shared);
+          }
+          for (size_t k = 0; k < names.size() && busy == 0; ++k) taken.Insert(tos[k]);
+          return busy;
+        };
+      if (size_t collided = claim())
+      {
+        m_collisions += collided;
+        if (m_options.collision == Collision::Abort)
+        {
+          Fail(Error("name collision, directory left untouched", path + Separator + String(names[0]), 0));
+          for (const auto& c : claims) m_folders->Release(c.first, c.second);   // nothing of this directory moves, so nothing of it may block others
+          return false;
+        }
+        if (m_options.collision == Collision::Skip) continue;   // the whole group, or it would come apart
+        // the first number free for every member, so the group keeps a common stem
+        std::vector<StringView> base(tos);
+        for (unsigned n = 1;; ++n)
+        {
+          for (size_t k = 0; k < names.size(); ++k) tos[k] = Numbered(base[k], n, m_options.sidecars, batch);
+          if (claim() == 0) break;
+        }
+      }
+      StringView into = folder.empty() ? StringView{} : batch.Name(folder, StringView{});
+      for (size_t k = 0; k < names.size(); ++k) batch.Add(names[k], tos[k], g, into);
+    }
+    m_planned += batch.Size();
+    if (m_options.progress) m_options.progress->matched += batch.Size();
+
+    uint32_t id{};
+    if (m_journal)
+    {
+      id = m_journal->Listed(path, listing.subdirs);
+      if (batch.Empty()) m_journal->Done(id);            // nothing to rename here, finished already
+    }
+    bool settled = batch.Empty();
+    plan.Add(path, batch, id);
+    return settled;
+  }
+
+  // Options::streaming: a directory renamed chunk by chunk while it is read, for folders of hundreds of thousands of
+  // files. The names given out so far are kept as a table of hashes (NameHashes), not as strings: it catches a renamed
+  // file read a second time further down the listing, and collisions within a chunk before it reaches the disk. A new
+  // name the table doesn't know is looked up on disk, where every other name in the directory is. Subdirectories go
+  // to the walk as each chunk turns them up; their names are kept only for the journal and the index.
+  // Per thread, Options::memoryLimit is a hard cap on what the directory holds: the read buffer, one chunk - sized
+  // for the longest names there can be, so that it fits whatever it holds - the table, which stops growing at what
+  // is left, and the kept subdirectory names, which are given up (and the directory not recorded) when they don't
+  // fit. A directory whose table fills up is left for the next run, which finds the renamed files out of the way.
+  // Collisions are settled per file: the abort policy stops at the first one instead of leaving the directory untouched.
+  void Renamer::StreamDirectory(const String& path, Listing& listing, Signature signature, bool indexed, Plan& plan, WorkPool* pool)
+  {
+    static constexpr size_t ChunkEntries = 4096;
+
+    DirectoryStream stream{};
+    try
+    {
+      Span span("list");
+      Throttle::Slot slot(m_listings.get());
+      stream.Open(path);
+    }
+    catch (const Error& e)
+    {
+      Fail(e);
+      return;
+    }
+
+    // A chunk of n entries at its largest: every name NAME_MAX long, in the listing or as a subdirectory and again
+    // in the plan; every new name as long as the longest prefix makes it, twice in the batch (a suffixed one too)
+    // and once in the plan; vectors just grown, the old buffer still there; arena chunks ended where a name didn't fit
+    size_t oldMost = 256;                                // NAME_MAX and the NUL
+    size_t newMost = 256;                                // the most an expanded template gives
+    for (const Rule& rule : m_rules.Rules()) newMost = std::max(newMost, rule.to.size());
+    newMost += oldMost;
+    size_t planMost = std::max(newMost, path.size() + 1);
+    size_t listChunk = 16 * 1024, batchChunk = std::max<size_t>(4 * 1024, 4 * newMost), planChunk = std::max<size_t>(64 * 1024, 4 * planMost);
+    auto arena = [](size_t chars, size_t most, size_t chunk) { return (chars / (chunk - most) + 1) * chunk * sizeof(Char); };
+    auto chunkBytes = [&](size_t n)
+      {
+        return arena(n * oldMost, oldMost, listChunk) + arena(2 * n * newMost, newMost, batchChunk) + arena(n * (oldMost + newMost) + path.size() + 1, planMost, planChunk)
+          + n * 2 * sizeof(StringView) + n * (3 * sizeof(String) + oldMost * sizeof(Char))   // files and others reserved, subdirectories
+          + 3 * n * (3 * sizeof(StringView) + sizeof(uint32_t) + sizeof(PlanEntry)) + 2 * sizeof(StringView);   // batch and plan vectors
+      };
+    unsigned threads = m_options.subdir && m_options.threads != 1 ? (m_options.threads != 0 ? m_options.threads : std::max(std::thread::hardware_concurrency(), 1u)) : 1;
+    size_t budget = m_options.memoryLimit / threads;
+    size_t fixed = stream.Bytes() + (path.size() + oldMost + newMost) * sizeof(Char);   // plus the path and suffix scratch strings
+    size_t entries = ChunkEntries;                       // the chunk takes at most half, the table and the subdirectories the rest
+    while (entries > 16 && fixed + chunkBytes(entries) > budget / 2) entries /= 2;
+    if (fixed + chunkBytes(entries) > budget / 2)
+    {
+      Fail(Error("memory limit too small to stream a directory", path, 0));
+      return;
+    }
+    size_t rest = budget - fixed - chunkBytes(entries);
+    ++m_directories;
+    if (m_options.progress) ++m_options.progress->directories;
+
+    // subdirectories are only known at the end: the directory is recorded once more then, with them, and marked done
+    uint32_t id = m_journal ? m_journal->Listed(path, std::vector<String>{}) : 0;
+    bool keep = m_journal || indexed;                    // the subdirectory names are needed at the end
+    size_t kept = 0;                                     // their bytes: strings and vector
+    NameHashes seen(m_options.ignoreCase, rest);         // the names given to files; the disk knows all the others
+    NameSet rule(m_options.ignoreCase);                  // for its case rule only
+    Directory dir{};
+    Listing chunk{};
+    chunk.files.reserve(entries);
+    chunk.others.reserve(entries);
+    String scratch{}, suffixed{};
+    size_t renames = 0;
+    bool complete = true;
+    try
+    {
+      dir.Open(path);
+      for (;;)
+      {
+        {
+          Span span("list");
+          if (Cancelled() || !stream.Next(m_rules, m_options.subdir, chunk, entries)) break;
+        }
+        if (!chunk.subdirs.empty()) Descend(path, chunk.subdirs, plan, pool);
+        if (keep && !chunk.subdirs.empty())
+        {
+          size_t want = listing.subdirs.size() + chunk.subdirs.size();
+          size_t capacity = want <= listing.subdirs.capacity() ? listing.subdirs.capacity() : std::max(want, 2 * listing.subdirs.capacity());
+          size_t strings = kept - listing.subdirs.capacity() * sizeof(String);
+          for (const String& subdir : chunk.subdirs) strings += (subdir.capacity() + 1) * sizeof(Char);
+          if (seen.Bytes() + strings + (listing.subdirs.capacity() + capacity) * sizeof(String) <= rest)   // while growing, both vectors are there
+          {
+            listing.subdirs.reserve(capacity);
+            for (String& subdir : chunk.subdirs) listing.subdirs.push_back(std::move(subdir));
+            kept = strings + listing.subdirs.capacity() * sizeof(String);
+          }
+          else
+          {
+            keep = false;                                // more than fit: the directory goes unrecorded instead
+            std::vector<String>().swap(listing.subdirs);
+            kept = 0;
+          }
+          seen.Limit(rest - kept);
+        }
+        size_t held = stream.Bytes() + chunk.names.Bytes() + (chunk.files.capacity() + chunk.others.capacity()) * sizeof(StringView) +
+          chunk.subdirs.capacity() * sizeof(String) + kept;
+        for (const String& subdir : chunk.subdirs) held += (subdir.capacity() + 1) * sizeof(Char);
+        std::sort(chunk.files.begin(), chunk.files.end());   // suffixes must not depend on enumeration order, within a chunk at least
+
+        Plan part{ planChunk };
+        Plan::Batch batch{ batchChunk };
+        uint32_t group = 0;
+        auto free = [&](StringView to) { return !seen.Contains(to) && !dir.Exists(to.data()); };
+        for (StringView name : chunk.files)
+        {
+          if (seen.Full())
+          {
+            Fail(Error("memory limit reached, the rest of the directory is left for the next run", path, 0));
+            complete = false;
+            break;
+          }
+          if (seen.Contains(name)) continue;             // a name this run gave a file, read once more: renamed already
+          const Rule* match = m_rules.Match(name);
+          const NameTemplate& pattern = m_templates[static_cast<size_t>(match - m_rules.Rules().data())];
+          StringView to{};
+          if (pattern.Plain()) to = batch.Name(match->to, name.substr(match->from.size()));
+          else
+          {
+            Exif exif{};
+            ReadMetadata(scratch.assign(path).append(1, Separator).append(name), exif);
+            Char prefix[256];
+            size_t n = pattern.Expand(exif, prefix, 256);
+            if (n == static_cast<size_t>(-1))
+            {
+              Fail(Error("no EXIF data for the new name", scratch, 0));
+              continue;
+            }
+            to = batch.Name(StringView(prefix, n), name.substr(match->from.size()));
+          }
+          if (!rule.Same(to, name) && !free(to))         // a pure case change is not a collision
+          {
+            ++m_collisions;
+            if (m_options.collision == Collision::Skip) continue;
+            if (m_options.collision == Collision::Abort)
+            {
+              Fail(Error("name collision, the rest of the directory is left untouched", path + Separator + String(name), 0));
+              complete = false;
+              break;
+            }
+            for (unsigned n = 1; !free(Numbered(to, n, suffixed)); ++n) {}
+            to = batch.Name(suffixed, StringView{});     // only the free one is stored
+          }
+          seen.Insert(to);
+          batch.Add(name, to, group++);
+        }
+        renames += batch.Size();
+        m_planned += batch.Size();
+        if (m_options.progress) m_options.progress->matched += batch.Size();
+        part.Add(path, batch, id);
+        held += batch.Bytes() + part.Bytes() + seen.Bytes();
+        for (size_t peak = m_memoryPeak; held > peak && !m_memoryPeak.compare_exchange_weak(peak, held);) {}
+        if (!part.Entries().empty() && !ApplyDirectory(part, 0, part.Entries().size(), false)) complete = false;
+        if (!complete) break;
+      }
+    }
+    catch (const Error& e)
+    {
+      Fail(e);
+      complete = false;
+    }
+
+    if (!complete || !keep || Cancelled()) return;
+    if (m_journal) m_journal->Done(m_journal->Listed(path, listing.subdirs));
+    if (renames == 0 && indexed) Settle(path, listing, signature);
+  }
+
+  // one ring per thread, set up on first use; nullptr if the kernel can't do it
+  static Uring* ThreadRing(unsigned depth)
+  {
+    static thread_local std::unique_ptr<Uring> ring{};
+    static thread_local bool tried{};
+    if (!tried)
+    {
+      tried = true;
+      ring = Uring::Create(depth);
+    }
+    return ring.get();
+  }
+
+  bool Renamer::ApplyDirectory(const Plan& plan, size_t begin, size_t end, bool finish)
+  {
+    if (Cancelled()) return false;                       // a directory is renamed completely or not at all
+    Span span("apply");
+    const std::vector<PlanEntry>& entries = plan.Entries();
+    StringView directory = plan.Directories()[entries[begin].directory];
+    uint32_t id = plan.Tags()[entries[begin].directory];
+    Uring* ring = m_options.queueDepth > 0 ? ThreadRing(m_options.queueDepth) : nullptr;
+    Directory dir;
+    bool complete = true;
+
+    try
+    {
+      dir.Open(String(directory));                       // plan names are NUL terminated leaf names, renamed relative to this
+    }
+    catch (const Error& e)
+    {
+      Fail(e);
+      return false;
+    }
+
+    // the new name as the journal has it: a leaf name, or the full path of a file moved into a folder
+    String moved{};
+    auto target = [&](const PlanEntry& entry)
+      {
+        if (entry.folder == Plan::InPlace) return entry.to;
+        moved.assign(plan.Folders()[entry.folder]).append(1, Separator).append(entry.to);
+        return StringView(moved);
+      };
+    auto unchanged = [](const PlanEntry& entry) { return entry.from == entry.to && entry.folder == Plan::InPlace; };
+    auto failed = [&](const Error& e, const PlanEntry& entry)
+      {
+        if (m_journal) m_journal->Undone(Journal::Rename{ String(directory), String(entry.from), String(target(entry)) });
+        Fail(e);
+        complete = false;
+      };
+    // with io_uring, a place in flight is taken at submission and given back at completion, timed per entry
+    Throttle* throttle = ring ? m_renames.get() : nullptr;
+    static thread_local std::vector<Throttle::Clock::time_point> submitted{};
+    if (throttle && submitted.size() < end - begin) submitted.resize(end - begin);
+
+    auto rename = [&](const PlanEntry& entry, Throttle* limit)   // limit: nullptr for a fallback from a completion, which already had its place
+      {
+        try
+        {
+          Span renaming("rename");
+          Throttle::Slot slot(limit);
+          if (entry.folder == Plan::InPlace) dir.Rename(entry.from.data(), entry.to.data());
+          else
+          {
+            m_folders->Create(String(plan.Folders()[entry.folder]));   // a lookup, once the folder is there
+            Platform::Move(dir.Path(entry.from), String(target(entry)));
+          }
+          Renamed();
+          return true;
+        }
+        catch (const Error& e)
+        {
+          failed(e, entry);
+          return false;
+        }
+      };
+    auto done = [&](uint64_t cookie, int result)
+      {
+        const PlanEntry& entry = entries[static_cast<size_t>(cookie)];
+        if (throttle) throttle->Release(Throttle::Clock::now() - submitted[static_cast<size_t>(cookie) - begin]);
+        if (result == 0) Renamed();
+        else if (result == -EINVAL) rename(entry, nullptr);   // file system without RENAME_NOREPLACE: the synchronous path knows what to do
+        else failed(Error("rename: " + std::generic_category().message(-result), dir.Path(entry.from), -result), entry);
+      };
+    const Uring::Completion completion{ done };          // wrapped once: a std::function per submission would allocate per file
+
+    // write ahead: every rename of the range is on record, and on disk, before the first one is issued
+    if (m_journal)
+    {
+      for (size_t i = begin; i < end; ++i)
+      {
+        if (!unchanged(entries[i])) m_journal->Renaming(id, entries[i].from, target(entries[i]));
+      }
+      m_journal->Sync();
+    }
+
+    for (size_t i = begin; i < end;)
+    {
+      size_t last = i + 1;                               // one past the group of entries[i]
+      while (last < end && entries[last].group == entries[i].group) ++last;
+      if (last - i > 1)
+      {
+        // a group goes one rename at a time, so that a failure can take back the renames before it
+        if (ring && ring->InFlight() > 0) ring->Drain(completion);
+        size_t k = i;
+        for (; k < last; ++k)
+        {
+          const PlanEntry& entry = entries[k];
+          if (unchanged(entry)) continue;
+          if (!rename(entry, m_renames.get())) break;
+        }
+        if (k < last)
+        {
+          for (size_t rest = k + 1; rest < last; ++rest)   // on record, never tried
+          {
+            if (m_journal && !unchanged(entries[rest])) m_journal->Undone(Journal::Rename{ String(directory), String(entries[rest].from), String(target(entries[rest])) });
+          }
+          while (k-- > i)
+          {
+            const PlanEntry& entry = entries[k];
+            if (unchanged(entry)) continue;
+            String to(target(entry));
+            try
+            {
+              if (entry.folder == Plan::InPlace) dir.Rename(entry.to.data(), entry.from.data());
+              else Platform::Move(to, dir.Path(entry.from));
+              Unrenamed();
+              if (m_journal) m_journal->Undone(Journal::Rename{ String(directory), String(entry.from), to });
+            }
+            catch (const Error& e)
+            {
+              Fail(Error(std::string("group split, could not rename back: ") + e.what(), entry.folder == Plan::InPlace ? dir.Path(entry.to) : to, e.Code()));
+            }
+          }
+        }
+        else
+        {
+          for (k = i; k < last; ++k) m_skipped += unchanged(entries[k]);
+        }
+        i = last;
+        continue;
+      }
+
+      const PlanEntry& entry = entries[i++];
+      if (unchanged(entry))                              // nothing to do, don't bother the file system
+      {
+        ++m_skipped;
+        continue;
+      }
+      if (ring && entry.folder == Plan::InPlace)
+      {
+        if (throttle && !throttle->TryAcquire())
+        {
+          ring->Drain(completion);                       // this thread's own renames may hold the places: finish them before waiting
+          throttle->Acquire();
+        }
+        if (throttle) submitted[i - 1 - begin] = Throttle::Clock::now();
+        ring->Rename(dir.Handle(), entry.from.data(), dir.Handle(), entry.to.data(), Uring::NoReplace, i - 1, completion);
+      }
+      else
+      {
+        if (ring && ring->InFlight() > 0) ring->Drain(completion);   // a move is synchronous, and may wait for a place the ring holds
+        rename(entry, m_renames.get());
+      }
+    }
+    if (ring)
+    {
+      Span drain("uring");
+      ring->Drain(completion);
+    }
+    if (m_journal && complete && finish) m_journal->Done(id);   // a resumed run will not look at this directory again
+    return complete;
+  }
+
+}
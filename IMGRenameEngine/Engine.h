@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint64_t
+#include <memory>           // For std::unique_ptr
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "Rules.h"
+#include "Template.h"
+
+namespace Engine
+{
+
+  class CancelToken;
+  class DirIndex;
+  class Folders;
+  struct Exif;
+  class Journal;
+  class MetaCache;
+  struct Listing;
+  class NameSet;
+  class Pipeline;
+  class Plan;
+  struct Progress;
+  class RateLimit;
+  struct Signature;
+  class Throttle;
+  class Traversal;
+  class WorkPool;
+
+  enum class Collision
+  {
+    Abort,                                               // leave the whole directory untouched and report it
+    Skip,                                                // leave only the colliding file alone
+    Suffix,                                              // rename to the first free name with _1, _2, ... before the extension
+  };
+
+  enum class Duplicates
+  {
+    Ignore,                                              // don't look for them
+    Report,                                              // list files with the same content as another planned file, rename them anyway
+    Skip,                                                // list them and leave them alone; the first copy in path order is renamed
+  };
+
+  struct Options
+  {
+    String path;                                         // root directory to process
+    String from;                                         // file name prefix to replace
+    String to;                                           // replacement prefix; may use EXIF fields, see NameTemplate
+    std::vector<Rule> rules;                             // more from -> to pairs, all handled in the same pass; the longest matching prefix wins
+    bool subdir{};                                       // also process all subdirectories
+    unsigned threads{ 1 };                               // traversal threads; 1 = serial, 0 = one per hardware thread
+    Collision collision{ Collision::Abort };             // what to do when a new name is already taken
+    String journal;                                      // journal file: resume the run recorded there and record this one; empty = none
+    String index;                                        // directory index file: skip listing directories unchanged since the last run; empty = none
+    String cache;                                        // metadata cache file: EXIF fields of files seen before; empty = none
+    size_t cacheLimit{ 1000000 };                        // most files the metadata cache remembers
+    unsigned queueDepth{};                               // renames in flight per thread through io_uring (Linux); 0 = synchronous renames
+    bool pipeline{};                                     // Run() as overlapping stages: enumerate (threads) -> read metadata -> plan -> apply
+    unsigned readers{ 4 };                               // pipeline: metadata reader threads
+    unsigned renamers{ 2 };                              // pipeline: rename threads
+    Progress* progress{};                                // counters to update while running, owned by the caller; nullptr = none
+    const CancelToken* cancel{};                         // stop early when cancelled, owned by the caller; nullptr = run to the end
+    bool adaptive{};                                     // tune listings and renames in flight to their latency, up to the thread count (SMB/NFS)
+    double opsPerSecond{};                               // hard cap on listings + renames per second; 0 = none
+    Duplicates duplicates{ Duplicates::Ignore };         // look for planned files with the same content before renaming; runs Run() without the pipeline
+    bool oneFileSystem{};                                // subdir: don't descend into directories on another file system (mount points)
+    bool streaming{};                                    // Run() renames each directory a chunk at a time while reading it, without a plan; in-place renames only
+    size_t memoryLimit{ 64 * 1024 * 1024 };              // streaming: bytes for chunks, name tables and subdirectory names of all threads together, never exceeded
+    String folders;                                      // move files into folders named by this template, e.g. "{Year}/{Month}/{Day}"; relative to path unless absolute; empty = rename in place
+    bool sidecars{};                                     // files sharing a stem (IMG_1234.CR2, .JPG, .xmp) are renamed together, all or none
+#ifdef _WIN32
+    bool ignoreCase{ true };                             // names differing only in case collide
+#else
+    bool ignoreCase{ false };                            // names differing only in case collide (set for FAT/exFAT/NTFS mounts)
+#endif
+  };
+
+  struct Failure
+  {
+    String path;                                         // file or directory the operation failed on
+    std::string message;
+    int code{};                                          // errno / GetLastError() value
+  };
+
+  struct Duplicate
+  {
+    String path;                                         // the copy
+    String original;                                     // the first planned file with the same content
+  };
+
+  // what one pipeline stage did; busy / files is its cost per file, the queue in front of it shows whether it kept up
+  struct StageStats
+  {
+    std::string name;
+    unsigned threads{};
+    size_t directories{};                                // jobs that went through the stage
+    size_t files{};                                      // rename candidates in those jobs
+    double busy{};                                       // seconds spent working, summed over the stage's threads
+    size_t queueMax{};                                   // most directories waiting in front of the stage
+    double queueMean{};                                  // directories waiting, on average, when the stage took one
+  };
+
+  struct Result
+  {
+    size_t directories{};                                // directories scanned
+    size_t resumed{};                                    // directories the journal reported finished, not scanned again
+    size_t unchanged{};                                  // directories the index reported unchanged, not scanned again
+    size_t revisited{};                                  // directories reached a second time through a link or mount, not scanned again
+    size_t planned{};                                    // renames in the plan
+    size_t renamed{};                                    // files renamed
+    size_t skipped{};                                    // plan entries that would not change anything
+    size_t collisions{};                                 // new names that were already taken
+    std::vector<Failure> failures;                       // everything that went wrong, sorted by path
+    std::vector<Duplicate> duplicates;                   // Options::duplicates only, sorted by path
+    uint64_t compared{};                                 // Options::duplicates only: bytes read to tell files apart
+    size_t memoryPeak{};                                 // streaming runs only: most bytes one directory held at once, as counted against Options::memoryLimit
+    std::vector<StageStats> stages;                      // pipeline runs only, in stage order
+    double seconds{};                                    // pipeline runs only: wall clock time
+    bool cancelled{};                                    // stopped early through Options::cancel
+    unsigned listLimit{};                                // adaptive runs only: listings in flight the controller ended up with
+    unsigned renameLimit{};                              // adaptive runs only: renames in flight the controller ended up with
+  };
+
+  // Headless rename engine; the dialog and the command line tool are thin front ends over it.
+  // A run is split in two stages: BuildPlan only reads the tree, Apply only renames.
+  class Renamer
+  {
+  public:
+    explicit Renamer(const Options& options);
+    ~Renamer();
+    Result BuildPlan(Plan& plan);                        // traverse the tree and decide every rename; nothing on disk changes
+    Result Apply(const Plan& plan);                      // execute a plan; a failure is recorded and the run carries on
+    Result Run();                                        // BuildPlan + Apply, journaled if Options::journal is set
+    static Result Undo(const String& journal);           // revert every rename recorded in a journal, newest first
+    Result RenameFiles(const String& directory, const std::vector<String>& names);   // plan and apply just these names of one directory, without listing it
+    const RuleSet& Rules() const { return m_rules; }     // from/to and Options::rules, compiled
+
+  private:
+    Result RunPipeline();                                // the BuildPlan + Apply part of Run() as a pipeline, see Pipeline.cpp
+    void ScanDirectory(const String& path, Plan& plan, WorkPool* pool);
+    void Descend(const String& path, const std::vector<String>& subdirs, Plan& plan, WorkPool* pool);
+    bool NeedsMetadata(StringView name) const;           // the rule for name builds the new name from EXIF fields
+    void ReadMetadata(const String& file, Exif& exif);   // through the metadata cache if there is one
+    bool PlanDirectory(const String& path, const Listing& listing, Plan& plan, const std::vector<Exif>* metadata);   // true if nothing in the directory needs renaming
+    void FindCopies(Plan& plan, Result& result);         // Options::duplicates: fill in result.duplicates, drop them from plan if asked to
+    String FolderPath(StringView folder) const;          // full path of an expanded folder template
+    void Settle(const String& path, const Listing& listing, Signature signature);   // record a directory without work in the index
+    bool ApplyDirectory(const Plan& plan, size_t begin, size_t end, bool finish = true);   // false if anything failed; finish: that is all of the directory, so the journal may mark it done
+    void StreamDirectory(const String& path, Listing& listing, Signature signature, bool indexed, Plan& plan, WorkPool* pool);   // Options::streaming: list and rename path in chunks, descend as subdirectories turn up
+    void Fail(const Error& e);
+    void Renamed();
+    void Unrenamed();                                    // a rename of a group was taken back
+    bool Cancelled() const;
+    Result Collect();                                    // hand out counters and failures gathered so far, then reset them
+
+  private:
+    Options m_options;
+    RuleSet m_rules;
+    std::vector<NameTemplate> m_templates;               // the rules' new prefixes, parallel to m_rules.Rules()
+    NameTemplate m_folder;                               // Options::folders
+    std::unique_ptr<Folders> m_folders;                  // Options::folders only: target folders seen and made
+    std::unique_ptr<Journal> m_journal;                  // open during Run() only
+    std::unique_ptr<DirIndex> m_index;                   // loaded during Run() only
+    std::unique_ptr<MetaCache> m_cache;                  // open during Run() only
+    std::unique_ptr<RateLimit> m_rate;                   // Options::opsPerSecond
+    std::unique_ptr<Throttle> m_listings;                // Options::adaptive or opsPerSecond, else nullptr
+    std::unique_ptr<Throttle> m_renames;
+    std::unique_ptr<Traversal> m_traversal;              // during BuildPlan() and RunPipeline() only: directories entered, pending ones
+    bool m_streaming{};                                  // set during a streaming Run() only: ScanDirectory renames as it lists
+    Pipeline* m_pipeline{};                              // set during RunPipeline() only: ScanDirectory hands directories to it
+    std::atomic<size_t> m_directories{};
+    std::atomic<size_t> m_resumed{};
+    std::atomic<size_t> m_unchanged{};
+    std::atomic<size_t> m_planned{};
+    std::atomic<size_t> m_renamed{};
+    std::atomic<size_t> m_skipped{};
+    std::atomic<size_t> m_collisions{};
+    std::atomic<size_t> m_memoryPeak{};
+    std::mutex m_lock;                                   // guards m_failures
+    std::vector<Failure> m_failures;
+  };
+
+}
@@ -0,0 +1,147 @@
+#include <cstdint>          // For uint16_t, uint32_t
+#include <cstring>          // For memcmp(), memcpy()
+
+#include "Exif.h"
+#include "Platform.h"
+
+namespace Engine
+{
+
+  // TIFF structure, read in place: every access is bounds checked against the bytes we have
+  class Tiff
+  {
+  public:
+    Tiff(const unsigned char* data, size_t size, bool big) : m_data(data), m_size(size), m_big(big) {}
+
+    bool U16(size_t at, uint16_t& v) const
+    {
+      if (at + 2 > m_size) return false;
+      v = m_big ? static_cast<uint16_t>(m_data[at] << 8 | m_data[at + 1]) : static_cast<uint16_t>(m_data[at + 1] << 8 | m_data[at]);
+      return true;
+    }
+
+    bool U32(size_t at, uint32_t& v) const
+    {
+      uint16_t a{}, b{};
+      if (!U16(at, a) || !U16(at + 2, b)) return false;
+      v = m_big ? static_cast<uint32_t>(a) << 16 | b : static_cast<uint32_t>(b) << 16 | a;
+      return true;
+    }
+
+    // copy an ASCII entry into out (NUL terminated, cut to fit); entry is the offset of the 12 byte IFD entry
+    void Ascii(size_t entry, char* out, size_t capacity) const
+    {
+      uint16_t type{};
+      uint32_t count{}, offset{};
+      if (!U16(entry + 2, type) || type != 2 || !U32(entry + 4, count) || count == 0) return;
+      size_t at = entry + 8;                             // up to 4 bytes are stored in the entry itself
+      if (count > 4)
+      {
+        if (!U32(entry + 8, offset)) return;
+        at = offset;
+      }
+      if (at >= m_size || count > m_size - at) return;   // beyond what we read: treat as missing
+      size_t n = 0;
+      while (n < count && n + 1 < capacity && m_data[at + n] != 0) ++n;
+      while (n > 0 && m_data[at + n - 1] == ' ') --n;    // models are often padded with blanks
+      memcpy(out, m_data + at, n);
+      out[n] = 0;
+    }
+
+    // call visit(tag, entry offset) for every entry of the IFD at offset
+    template <typename Visit> bool Walk(uint32_t offset, Visit visit) const
+    {
+      uint16_t count{};
+      if (!U16(offset, count)) return false;
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        size_t entry = offset + 2 + i * 12u;
+        uint16_t tag{};
+        if (!U16(entry, tag) || entry + 12 > m_size) break;
+        visit(tag, entry);
+      }
+      return true;
+    }
+
+  private:
+    const unsigned char* m_data;
+    size_t m_size;
+    bool m_big;
+  };
+
+  static constexpr uint16_t TagModel = 0x0110;
+  static constexpr uint16_t TagExifIfd = 0x8769;
+  static constexpr uint16_t TagDateTimeOriginal = 0x9003;
+  static constexpr uint16_t TagSubSecTime = 0x9290;
+  static constexpr uint16_t TagSubSecTimeOriginal = 0x9291;
+
+  static bool ParseTiff(const unsigned char* data, size_t size, Exif& exif)
+  {
+    if (size < 8) return false;
+    bool big;
+    if (memcmp(data, "II*\0", 4) == 0) big = false;
+    else if (memcmp(data, "MM\0*", 4) == 0) big = true;
+    else return false;
+
+    Tiff tiff(data, size, big);
+    uint32_t ifd0{};
+    uint32_t exifIfd{};
+    if (!tiff.U32(4, ifd0)) return false;
+    tiff.Walk(ifd0, [&](uint16_t tag, size_t entry)
+      {
+        if (tag == TagModel) tiff.Ascii(entry, exif.model, sizeof(exif.model));
+        else if (tag == TagExifIfd) tiff.U32(entry + 8, exifIfd);
+      });
+    if (exifIfd != 0)
+    {
+      char subSec[sizeof(exif.subSecTime)]{};
+      tiff.Walk(exifIfd, [&](uint16_t tag, size_t entry)
+        {
+          if (tag == TagDateTimeOriginal) tiff.Ascii(entry, exif.dateTimeOriginal, sizeof(exif.dateTimeOriginal));
+          else if (tag == TagSubSecTimeOriginal) tiff.Ascii(entry, exif.subSecTime, sizeof(exif.subSecTime));
+          else if (tag == TagSubSecTime) tiff.Ascii(entry, subSec, sizeof(subSec));
+        });
+      if (exif.subSecTime[0] == 0) memcpy(exif.subSecTime, subSec, sizeof(subSec));   // the original's fraction if there is one
+    }
+    return exif.dateTimeOriginal[0] != 0 || exif.model[0] != 0;
+  }
+
+  bool Exif::Parse(const unsigned char* data, size_t size)
+  {
+    dateTimeOriginal[0] = 0;
+    subSecTime[0] = 0;
+    model[0] = 0;
+
+    if (size >= 4 && data[0] == 0xFF && data[1] == 0xD8)   // JPEG: walk the segments up to the APP1 one with "Exif\0\0"
+    {
+      size_t at = 2;
+      while (at + 4 <= size && data[at] == 0xFF)
+      {
+        unsigned char marker = data[at + 1];
+        size_t length = static_cast<size_t>(data[at + 2]) << 8 | data[at + 3];   // includes the two length bytes
+        if (marker == 0xDA || marker == 0xD9 || length < 2) break;   // image data starts, no EXIF before it
+        if (marker == 0xE1 && length >= 8 && at + 10 <= size && memcmp(data + at + 4, "Exif\0\0", 6) == 0)
+        {
+          size_t start = at + 10;
+          size_t end = at + 2 + length < size ? at + 2 + length : size;
+          return ParseTiff(data + start, end - start, *this);
+        }
+        at += 2 + length;
+      }
+      return false;
+    }
+    return ParseTiff(data, size, *this);                 // TIFF and the raw formats built on it
+  }
+
+  bool Exif::Read(const String& path, size_t* bytes)
+  {
+    dateTimeOriginal[0] = 0;
+    subSecTime[0] = 0;
+    model[0] = 0;
+    unsigned char head[HeadSize];
+    size_t n = Platform::ReadHead(path, head, sizeof(head));
+    if (bytes != nullptr) *bytes += n;
+    return n > 0 && Parse(head, n);
+  }
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+
+#include "Common.h"
+
+namespace Engine
+{
+
+  // The few EXIF fields new names can be built from, in fixed buffers: reading them allocates nothing.
+  // Strings are NUL terminated ASCII as stored in the file; an empty string means the file doesn't have the field.
+  struct Exif
+  {
+    static constexpr size_t HeadSize{ 8 * 1024 };      // bytes read from the start of a file; camera JPEGs and raws keep IFD0 and the Exif IFD in there
+
+    char dateTimeOriginal[20];                           // "YYYY:MM:DD HH:MM:SS"
+    char subSecTime[10];                                 // fraction of the second, digits only
+    char model[64];                                      // camera model, e.g. "Canon EOS 6D"
+
+    // parse the first bytes of a JPEG, TIFF or TIFF based raw (CR2, NEF, ARW, DNG); false if there is no EXIF in there
+    bool Parse(const unsigned char* data, size_t size);
+    bool Read(const String& path, size_t* bytes = nullptr);   // read the head of a file and parse it; false if unreadable or no EXIF; adds the bytes read to *bytes
+  };
+
+}
@@ -0,0 +1,70 @@
+#include "Folders.h"
+
+namespace Engine
+{
+
+  size_t Folders::Claim(const String& folder, const std::vector<StringView>& names, const Listing* listing)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    std::unique_ptr<Folder>& f = m_folders[folder];
+    if (!f && listing != nullptr && !listing->partial)
+    {
+      // the caller's listing goes away with its directory: its names are copied, the way a claimed name is
+      f = std::make_unique<Folder>(m_ignoreCase);
+      f->names.Reserve(listing->files.size() + listing->subdirs.size() + listing->others.size() + 16);
+      for (StringView name : listing->files) f->names.Insert(f->listing.names.Store(name));
+      for (const String& name : listing->subdirs) f->names.Insert(f->listing.names.Store(name));
+      for (StringView name : listing->others) f->names.Insert(f->listing.names.Store(name));
+      m_existing.insert(folder);
+    }
+    else if (!f)
+    {
+      f = std::make_unique<Folder>(m_ignoreCase);
+      try
+      {
+        Platform::Scan(folder, RuleSet{}, false, f->listing);   // no rules: every entry lands in others
+        m_existing.insert(folder);
+      }
+      catch (const Error&)
+      {
+        f->listing.Clear();                              // not there yet; if it is there after all, the rename won't replace anything
+      }
+      f->names.Reserve(f->listing.others.size() + 16);
+      for (StringView name : f->listing.others) f->names.Insert(name);
+    }
+
+    size_t taken = 0;
+    for (StringView name : names) taken += f->names.Contains(name);
+    if (taken > 0) return taken;
+    for (StringView name : names) f->names.Insert(f->listing.names.Store(name));
+    return 0;
+  }
+
+  void Folders::Release(const String& folder, const std::vector<StringView>& names)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    auto it = m_folders.find(folder);
+    if (it == m_folders.end()) return;
+    for (StringView name : names) it->second->names.Erase(name);   // the copy in the folder's arena stays until the run ends
+  }
+
+  void Folders::Create(const String& folder)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    Make(folder);
+  }
+
+  void Folders::Make(const String& folder)
+  {
+    if (m_existing.count(folder) != 0) return;
+    if (!Platform::MakeDirectory(folder))
+    {
+      size_t end = folder.rfind(Separator);
+      if (end == String::npos || end == 0) throw Error("no such directory", folder, 0);
+      Make(folder.substr(0, end));
+      if (!Platform::MakeDirectory(folder)) throw Error("no such directory", folder, 0);
+    }
+    m_existing.insert(folder);
+  }
+
+}
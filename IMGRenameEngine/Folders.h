@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <memory>           // For std::unique_ptr
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "NameSet.h"
+#include "Platform.h"
+
+namespace Engine
+{
+
+  // The folders a reorganising run (Options::folders) moves files into, shared by all threads. Each folder is listed
+  // once, the first time a file is headed for it, and every new name is checked against that listing and the names
+  // already promised in it, in memory. Renames in place claim their names here too, as any directory may be a folder;
+  // they hand in the listing they have, so no directory is read twice. Folders are created when the first file moves
+  // in, missing parents included, and remembered as existing from then on: a run issues one mkdir per folder, not a
+  // mkdir or stat per file.
+  class Folders
+  {
+  public:
+    explicit Folders(bool ignoreCase) : m_ignoreCase(ignoreCase) {}
+
+    size_t Claim(const String& folder, const std::vector<StringView>& names, const Listing* listing = nullptr);   // names already taken in folder; if none, they are all claimed now. listing: the folder's own, if the caller has read it
+    void Release(const String& folder, const std::vector<StringView>& names);   // give back names Claim() handed out, for renames that are dropped
+    void Create(const String& folder);                   // make sure folder exists; throws Error
+
+  private:
+    struct Folder
+    {
+      explicit Folder(bool ignoreCase) : names(ignoreCase) {}
+      Listing listing;                                   // the folder as found, plus storage for claimed names
+      NameSet names;
+    };
+
+    void Make(const String& folder);                     // Create() with m_lock held
+
+  private:
+    bool m_ignoreCase;
+    std::mutex m_lock;                                   // guards everything below
+    std::unordered_map<String, std::unique_ptr<Folder>> m_folders;
+    std::unordered_set<String> m_existing;               // directories known to be there
+  };
+
+}
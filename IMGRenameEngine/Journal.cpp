@@ -0,0 +1,275 @@
+#include <algorithm>        // For std::max, std::find
+#include <cstring>          // For memcpy()
+
+#include "Journal.h"
+
+namespace Engine
+{
+
+  // record layout: length of the strings in bytes, type, directory id, strings (each NUL terminated), padding to 4, checksum
+  struct RecordHeader
+  {
+    uint32_t length;
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t directory;
+  };
+
+  static constexpr char Magic[8]{ 'I', 'M', 'G', 'J', 'R', 'N', 'L', char('0' + sizeof(Char)) };
+  static constexpr size_t MinimumSize{ 1024 * 1024 };
+
+  static inline size_t Align(size_t n) { return (n + 3) & ~size_t{ 3 }; }
+
+  static uint32_t Checksum(const char* data, size_t size)   // FNV-1a, cheap and good enough to spot a torn record
+  {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+    {
+      h ^= static_cast<unsigned char>(data[i]);
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  // split the NUL separated strings of a record
+  static std::vector<String> Strings(const char* data, size_t length)
+  {
+    std::vector<String> result{};
+    const Char* p = reinterpret_cast<const Char*>(data);
+    const Char* end = p + length / sizeof(Char);
+    while (p < end)
+    {
+      const Char* q = std::find(p, end, Char{});
+      result.emplace_back(p, q);
+      p = q + 1;
+    }
+    return result;
+  }
+
+  void Journal::Open(const String& file)
+  {
+    m_file.Open(file, true);
+    if (m_file.Size() >= sizeof(Magic) && memcmp(m_file.Data(), Magic, sizeof(Magic)) != 0)
+    {
+      m_file.Close();
+      throw Error("not a rename journal", file, 0);      // never scribble over somebody else's file
+    }
+    Load();
+  }
+
+  void Journal::Open(const String& file, const String& root, const String& rules)
+  {
+    Open(file);
+    if (m_end == 0)
+    {
+      StringView header[]{ root, rules };
+      Append(Header, 0, header, 2);
+      return;
+    }
+
+    RecordHeader h{};
+    memcpy(&h, m_file.Data() + sizeof(Magic), sizeof(h));
+    std::vector<String> header = Strings(m_file.Data() + sizeof(Magic) + sizeof(RecordHeader), h.length);
+    if (h.type != Header || header.size() != 2 || header[0] != root || header[1] != rules)
+    {
+      m_file.Close();
+      throw Error("journal belongs to a different run", file, 0);
+    }
+    if (Complete())
+    {
+      // nothing to resume: a new run, whose directories are all to be looked at again (Load() does the same on reading)
+      StringView again[]{ root, rules };
+      Append(Header, 0, again, 2);
+      m_finished.clear();
+      m_targets.clear();
+    }
+  }
+
+  bool Journal::Complete() const
+  {
+    for (const String& path : m_paths)
+    {
+      if (m_finished.count(path) == 0) return false;
+    }
+    return !m_paths.empty();
+  }
+
+  void Journal::Load()
+  {
+    m_end = 0;
+    const char* data = m_file.Data();
+    size_t size = m_file.Size();
+    if (size < sizeof(Magic) || memcmp(data, Magic, sizeof(Magic)) != 0) return;
+
+    // Move records not reverted yet, by directory, from and to, so that a Revert record finds its Move in O(1)
+    std::unordered_map<String, std::vector<size_t>> moves{};
+    std::vector<char> reverted{};                        // parallel to m_renames
+    size_t run = 0;                                      // first rename of the latest run
+    String key{};
+    auto keyOf = [&key](const String& directory, const String& from, const String& to) -> const String&
+      {
+        return key.assign(directory).append(1, Char{}).append(from).append(1, Char{}).append(to);
+      };
+
+    size_t pos = sizeof(Magic);
+    while (pos + sizeof(RecordHeader) + sizeof(uint32_t) <= size)
+    {
+      RecordHeader h{};
+      memcpy(&h, data + pos, sizeof(h));
+      size_t body = sizeof(RecordHeader) + Align(h.length);
+      if (h.type == 0 || pos + body + sizeof(uint32_t) > size) break;
+      uint32_t sum{};
+      memcpy(&sum, data + pos + body, sizeof(sum));
+      if (sum != Checksum(data + pos, body)) break;      // torn write: everything from here on is lost
+      if ((h.type == Move || h.type == Finish) && h.directory >= m_paths.size()) break;
+
+      std::vector<String> s = Strings(data + pos + sizeof(RecordHeader), h.length);
+      switch (h.type)
+      {
+        case Header:
+          if (pos > sizeof(Magic))                       // a new run after one that went through: nothing is finished for it
+          {
+            m_finished.clear();
+            run = m_renames.size();
+          }
+          break;
+        case Dir:
+          m_paths.push_back(s.at(0));
+          m_subdirs.emplace_back(s.begin() + 1, s.end());
+          break;
+        case Move:
+          moves[keyOf(m_paths[h.directory], s.at(0), s.at(1))].push_back(m_renames.size());
+          m_renames.push_back(Rename{ m_paths[h.directory], s.at(0), s.at(1) });
+          reverted.push_back(0);
+          break;
+        case Finish:
+          m_finished[m_paths[h.directory]] = h.directory;
+          break;
+        case Revert:
+          {
+            auto it = moves.find(keyOf(s.at(0), s.at(1), s.at(2)));
+            if (it != moves.end() && !it->second.empty())
+            {
+              reverted[it->second.back()] = 1;           // the latest one: the same rename may have been done, undone and done again
+              it->second.pop_back();
+            }
+            m_finished.erase(s.at(0));                   // the directory has work to do again
+          }
+          break;
+        default:
+          break;
+      }
+      pos += body + sizeof(uint32_t);
+      m_end = pos;
+    }
+    m_next = static_cast<uint32_t>(m_paths.size());
+    m_synced = m_end;
+
+    // what is left are the renames not undone; the targets are those of the latest run only
+    size_t kept = 0;
+    for (size_t i = 0; i < m_renames.size(); ++i)
+    {
+      if (reverted[i]) continue;
+      if (i >= run) m_targets[m_renames[i].directory].push_back(m_renames[i].to);
+      if (kept != i) m_renames[kept] = std::move(m_renames[i]);
+      ++kept;
+    }
+    m_renames.resize(kept);
+  }
+
+  uint32_t Journal::Append(Type type, uint32_t directory, const StringView* strings, size_t count)
+  {
+    size_t length = 0;
+    for (size_t i = 0; i < count; ++i) length += (strings[i].size() + 1) * sizeof(Char);
+    size_t body = sizeof(RecordHeader) + Align(length);
+    size_t total = body + sizeof(uint32_t);
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (type == Dir) directory = m_next++;               // ids follow the order of the Dir records, so Load() can recount them
+    if (m_end == 0) m_end = sizeof(Magic);
+    if (m_end + total > m_file.Size())
+    {
+      m_file.Resize(std::max({ MinimumSize, m_file.Size() * 2, m_end + total }));
+      memcpy(m_file.Data(), Magic, sizeof(Magic));
+    }
+
+    char* p = m_file.Data() + m_end;
+    RecordHeader h{ static_cast<uint32_t>(length), type, 0, directory };
+    memcpy(p, &h, sizeof(h));
+    char* q = p + sizeof(h);
+    for (size_t i = 0; i < count; ++i)
+    {
+      StringView s = strings[i];
+      memcpy(q, s.data(), s.size() * sizeof(Char));
+      q += s.size() * sizeof(Char);
+      memset(q, 0, sizeof(Char));
+      q += sizeof(Char);
+    }
+    memset(q, 0, p + body - q);                          // padding
+    uint32_t sum = Checksum(p, body);
+    memcpy(p + body, &sum, sizeof(sum));
+    m_end += total;
+    if (type == Finish) m_file.Flush(false);             // a finished directory is worth making durable
+    return directory;
+  }
+
+  void Journal::Sync()
+  {
+    std::lock_guard<std::mutex> guard(m_lock);           // held throughout: an Append() that grows the file remaps it
+    if (m_synced >= m_end) return;
+    m_file.Flush(m_synced, m_end, true);
+    m_synced = m_end;
+  }
+
+  void Journal::Close()
+  {
+    if (!m_file.IsOpen()) return;
+    if (m_end > 0) m_file.Resize(m_end);
+    m_file.Flush(true);
+    m_file.Close();
+  }
+
+  bool Journal::Finished(const String& directory, std::vector<String>& subdirs) const
+  {
+    auto it = m_finished.find(directory);
+    if (it == m_finished.end()) return false;
+    subdirs = m_subdirs[it->second];
+    return true;
+  }
+
+  const std::vector<String>* Journal::Targets(const String& directory) const
+  {
+    auto it = m_targets.find(directory);
+    return it == m_targets.end() || it->second.empty() ? nullptr : &it->second;
+  }
+
+  std::vector<Journal::Rename> Journal::Renames() const
+  {
+    return m_renames;
+  }
+
+  uint32_t Journal::Listed(const String& directory, const std::vector<String>& subdirs)
+  {
+    std::vector<StringView> strings{ directory };
+    strings.insert(strings.end(), subdirs.begin(), subdirs.end());
+    return Append(Dir, 0, strings.data(), strings.size());
+  }
+
+  void Journal::Renaming(uint32_t directory, StringView from, StringView to)
+  {
+    StringView strings[]{ from, to };                    // no vector: this runs once per file
+    Append(Move, directory, strings, 2);
+  }
+
+  void Journal::Done(uint32_t directory)
+  {
+    Append(Finish, directory, nullptr, 0);
+  }
+
+  void Journal::Undone(const Rename& rename)
+  {
+    StringView strings[]{ rename.directory, rename.from, rename.to };
+    Append(Revert, 0, strings, 3);
+  }
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint32_t
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Platform.h"
+
+namespace Engine
+{
+
+  // Append-only, memory-mapped log of a run. Every record carries a checksum, so after a crash the log is valid
+  // up to the last complete record. Opening an existing journal loads what it says about the earlier run:
+  // which directories are finished (and what their subdirectories were) and which renames already happened.
+  // Renames are write-ahead: the caller records a batch of them, then Sync()s once before issuing any, so after a
+  // power loss every rename on disk has its record - one flush per directory, not per file. A journal whose run
+  // went through to the end starts a new run on reopening; Undo still reverts the renames of both, newest first.
+  class Journal
+  {
+  public:
+    struct Rename
+    {
+      String directory;
+      String from;
+      String to;
+    };
+
+    Journal() = default;
+    ~Journal() { Close(); }
+
+    void Open(const String& file);                       // open or create; throws Error
+    void Open(const String& file, const String& root, const String& rules);   // same, for a run (rules: RuleSet::Key()); also throws if the journal belongs to another run
+    void Close();                                        // trims the file to what was written
+
+    // state of the earlier run, read-only while the run is going on
+    bool Finished(const String& directory, std::vector<String>& subdirs) const;   // true if directory was completed, subdirs as listed then
+    const std::vector<String>* Targets(const String& directory) const;            // names files in directory were renamed to, or nullptr
+    std::vector<Rename> Renames() const;                                          // renames not undone yet, in the order they happened
+
+    // appending; thread safe
+    uint32_t Listed(const String& directory, const std::vector<String>& subdirs);  // directory scanned; returns its id for the records below
+    void Renaming(uint32_t directory, StringView from, StringView to);   // written before the rename, so a crash can't hide a done rename
+    void Sync();                                         // wait until everything appended so far is on disk
+    void Done(uint32_t directory);                       // every rename of the directory went through
+    void Undone(const Rename& rename);                   // a rename was reverted, or failed after Renaming()
+
+  private:
+    enum Type : uint16_t { Header = 1, Dir = 2, Move = 3, Finish = 4, Revert = 5 };
+
+    void Load();
+    bool Complete() const;                               // every directory listed was finished
+    uint32_t Append(Type type, uint32_t directory, const StringView* strings, size_t count);   // Dir records get the next id, which is returned
+
+  private:
+    MappedFile m_file;
+    std::mutex m_lock;                                   // guards appending
+    size_t m_end{};                                      // end of the last valid record
+    size_t m_synced{};                                   // everything before this is on disk
+    uint32_t m_next{};                                   // next directory id
+
+    std::vector<String> m_paths;                         // directory id -> path
+    std::vector<std::vector<String>> m_subdirs;          // directory id -> subdirectories at scan time
+    std::unordered_map<String, uint32_t> m_finished;     // path -> id of the completed listing
+    std::unordered_map<String, std::vector<String>> m_targets;
+    std::vector<Rename> m_renames;
+  };
+
+}
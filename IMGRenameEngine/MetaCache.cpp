@@ -0,0 +1,171 @@
+#include <algorithm>        // For std::sort, std::max
+#include <cstring>          // For memcmp(), memcpy(), memset()
+#include <vector>
+
+#include "Exif.h"
+#include "MetaCache.h"
+
+namespace Engine
+{
+
+  // file layout: header, then capacity records; a record with generation 0 is a free slot
+  static constexpr char Magic[8]{ 'I', 'M', 'G', 'M', 'E', 'T', 'A', '1' };
+  static constexpr size_t MinimumCapacity = 1024;
+
+  struct MetaCache::Header
+  {
+    char magic[8];
+    uint64_t capacity;                                   // slots, a power of two
+    uint64_t count;                                      // used slots
+    uint32_t generation;                                 // number of the current run, never 0
+    uint32_t dirty;                                      // set while a run has the file open: a crash leaves it set
+  };
+
+  struct MetaCache::Record
+  {
+    FileId id;
+    uint32_t generation;                                 // run that last used the entry
+    uint32_t reserved;
+    char dateTimeOriginal[20];
+    char subSecTime[10];
+    char model[64];
+    char padding[2];
+  };
+
+  static_assert(sizeof(Exif::dateTimeOriginal) == 20 && sizeof(Exif::subSecTime) == 10 && sizeof(Exif::model) == 64, "record layout follows Exif");
+
+  static inline size_t Hash(const FileId& id)
+  {
+    uint64_t h = id.inode * 0x9E3779B97F4A7C15ull ^ id.device;   // inodes are unique per device
+    return static_cast<size_t>(h ^ (h >> 29));
+  }
+
+  static size_t Capacity(size_t count)                   // smallest table that keeps the load factor at most 1/2
+  {
+    size_t capacity = MinimumCapacity;
+    while (capacity < count * 2) capacity *= 2;
+    return capacity;
+  }
+
+  MetaCache::Record* MetaCache::Table() const
+  {
+    return reinterpret_cast<Record*>(m_file.Data() + sizeof(Header));
+  }
+
+  void MetaCache::Open(const String& file, size_t limit)
+  {
+    Close();
+    m_limit = std::max<size_t>(limit, 1);
+    m_broken = false;
+    m_file.Open(file, true);
+    const Header* h = m_file.Size() >= sizeof(Header) ? &Head() : nullptr;
+    bool valid = h != nullptr && memcmp(h->magic, Magic, sizeof(Magic)) == 0 && h->dirty == 0 &&
+      (h->capacity & (h->capacity - 1)) == 0 && m_file.Size() == sizeof(Header) + h->capacity * sizeof(Record);
+    if (!valid)                                          // new, foreign or left behind by a crash: it's only a cache, start over
+    {
+      m_file.Resize(sizeof(Header) + MinimumCapacity * sizeof(Record));
+      memset(m_file.Data(), 0, m_file.Size());
+      memcpy(Head().magic, Magic, sizeof(Magic));
+      Head().capacity = MinimumCapacity;
+    }
+    Header& head = Head();
+    head.generation = head.generation + 1 == 0 ? 1 : head.generation + 1;
+    head.dirty = 1;
+    m_file.Flush(true);
+  }
+
+  void MetaCache::Close()
+  {
+    if (!m_file.IsOpen()) return;
+    if (m_broken)
+    {
+      m_file.Close();                                    // still marked dirty, so the next run starts over
+      return;
+    }
+    Header& head = Head();
+    size_t keep = std::min<size_t>(head.count, m_limit);
+    if (keep < head.count || Capacity(keep) < head.capacity / 4) Rebuild(Capacity(keep), keep);   // over the cap, or mostly empty
+    Head().dirty = 0;
+    m_file.Flush(true);
+    m_file.Close();
+  }
+
+  MetaCache::Record* MetaCache::Slot(const FileId& id) const
+  {
+    Record* table = Table();
+    size_t mask = static_cast<size_t>(Head().capacity) - 1;
+    for (size_t i = Hash(id) & mask;; i = (i + 1) & mask)   // the load factor stays below 1, so there is always a free slot
+    {
+      Record& r = table[i];
+      if (r.generation == 0 || (r.id.device == id.device && r.id.inode == id.inode)) return &r;
+    }
+  }
+
+  bool MetaCache::Find(const FileId& id, Exif& exif)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_broken) return false;
+    Record* r = Slot(id);
+    if (r->generation == 0 || r->id.size != id.size || r->id.mtime != id.mtime) return false;   // unknown, or written to since
+    r->generation = Head().generation;
+    memcpy(exif.dateTimeOriginal, r->dateTimeOriginal, sizeof(exif.dateTimeOriginal));
+    memcpy(exif.subSecTime, r->subSecTime, sizeof(exif.subSecTime));
+    memcpy(exif.model, r->model, sizeof(exif.model));
+    return true;
+  }
+
+  void MetaCache::Store(const FileId& id, const Exif& exif)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_broken) return;
+    Record* r = Slot(id);
+    if (r->generation == 0)
+    {
+      size_t count = static_cast<size_t>(Head().count);
+      try
+      {
+        if (count >= m_limit) Rebuild(static_cast<size_t>(Head().capacity), m_limit * 3 / 4);   // make room: drop the oldest quarter
+        else if ((count + 1) * 2 > Head().capacity) Rebuild(static_cast<size_t>(Head().capacity) * 2, count);
+      }
+      catch (const Error&)
+      {
+        m_broken = true;                                 // the mapping is gone
+        throw;
+      }
+      r = Slot(id);                                      // the table may have moved
+      ++Head().count;
+    }
+    r->id = id;
+    r->generation = Head().generation;
+    memcpy(r->dateTimeOriginal, exif.dateTimeOriginal, sizeof(r->dateTimeOriginal));
+    memcpy(r->subSecTime, exif.subSecTime, sizeof(r->subSecTime));
+    memcpy(r->model, exif.model, sizeof(r->model));
+  }
+
+  void MetaCache::Rebuild(size_t capacity, size_t keep)
+  {
+    std::vector<Record> records{};
+    records.reserve(static_cast<size_t>(Head().count));
+    const Record* table = Table();
+    for (size_t i = 0; i < Head().capacity; ++i)
+    {
+      if (table[i].generation != 0) records.push_back(table[i]);
+    }
+    if (records.size() > keep)
+    {
+      // newest first; generations count up from the current one backwards, across the wrap-around
+      uint32_t now = Head().generation;
+      std::sort(records.begin(), records.end(), [now](const Record& a, const Record& b) { return now - a.generation < now - b.generation; });
+      records.resize(keep);
+    }
+
+    Header head = Head();
+    m_file.Resize(sizeof(Header) + capacity * sizeof(Record));
+    memset(m_file.Data(), 0, m_file.Size());
+    head.capacity = capacity;
+    head.count = records.size();
+    Head() = head;
+    for (const Record& r : records) *Slot(r.id) = r;
+  }
+
+}
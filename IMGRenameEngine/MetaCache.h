@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint32_t, uint64_t
+#include <mutex>
+
+#include "Platform.h"
+
+namespace Engine
+{
+
+  struct Exif;
+
+  // Persistent cache of the EXIF fields of files, so a rerun over an unchanged archive reads no file at all.
+  // An open addressing hash table in a memory-mapped file, keyed by file identity: a file keeps its entry when it is
+  // renamed, and loses it when it is written to. Every run stamps the entries it uses; when the table reaches its size
+  // cap, the entries unused for the longest time go first.
+  class MetaCache
+  {
+  public:
+    MetaCache() = default;
+    ~MetaCache()
+    {
+      try { Close(); } catch (const Error&) {}           // Run() closes it and reports errors; this is the path for exceptions
+    }
+
+    void Open(const String& file, size_t limit);         // limit: most files remembered; throws Error
+    void Close();                                        // compact and write back; throws Error
+
+    bool Find(const FileId& id, Exif& exif);             // thread safe
+    void Store(const FileId& id, const Exif& exif);      // thread safe; also for files without EXIF, so they aren't read again; throws Error
+
+  private:
+    struct Header;
+    struct Record;
+
+    Header& Head() const { return *reinterpret_cast<Header*>(m_file.Data()); }
+    Record* Table() const;
+    Record* Slot(const FileId& id) const;                 // the slot holding this file, or the free slot it would go into
+    void Rebuild(size_t capacity, size_t keep);          // rehash into a table of capacity slots, keeping the keep newest entries
+
+  private:
+    MappedFile m_file;
+    size_t m_limit{};
+    bool m_broken{};                                     // growing the file failed: ignore it for the rest of the run
+    std::mutex m_lock;
+  };
+
+}
@@ -0,0 +1,183 @@
+#include <algorithm>        // For std::fill
+#include <wctype.h>         // For towupper()
+
+#include "NameSet.h"
+
+namespace Engine
+{
+
+  static inline Char Fold(Char c)
+  {
+    if (c >= IMG_TEXT('a') && c <= IMG_TEXT('z')) return static_cast<Char>(c - IMG_TEXT('a') + IMG_TEXT('A'));
+#ifdef _WIN32
+    if (c >= 0x80) return static_cast<Char>(::towupper(c));   // close enough to the NTFS upcase table for camera file names
+#endif
+    return c;
+  }
+
+  static uint64_t Fnv(StringView name, bool ignoreCase)
+  {
+    uint64_t h = 14695981039346656037ull;                // FNV-1a
+    for (Char c : name)
+    {
+      h ^= static_cast<uint64_t>(ignoreCase ? Fold(c) : c);
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  size_t NameSet::Hash(StringView name) const
+  {
+    return static_cast<size_t>(Fnv(name, m_ignoreCase));
+  }
+
+  bool NameSet::Same(StringView a, StringView b) const
+  {
+    if (a.size() != b.size()) return false;
+    if (!m_ignoreCase) return a == b;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+      if (Fold(a[i]) != Fold(b[i])) return false;
+    }
+    return true;
+  }
+
+  const NameSet::Slot* NameSet::Find(StringView name, size_t hash) const
+  {
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+      const Slot& slot = m_slots[i];
+      if (slot.name.data() == nullptr) return &slot;
+      if (slot.hash == hash && Same(slot.name, name)) return &slot;
+    }
+  }
+
+  void NameSet::Reserve(size_t n)
+  {
+    size_t want = 16;
+    while (want < n * 2) want *= 2;                      // keep the load factor at or below 1/2
+    if (want <= m_slots.size()) return;
+
+    std::vector<Slot> old{};
+    old.swap(m_slots);
+    m_slots.assign(want, Slot{ StringView{}, 0, 0 });
+    for (const Slot& slot : old)
+    {
+      if (slot.name.data() != nullptr) *const_cast<Slot*>(Find(slot.name, slot.hash)) = slot;
+    }
+  }
+
+  void NameSet::Grow()
+  {
+    Reserve(m_size + 1);
+  }
+
+  bool NameSet::Insert(StringView name)
+  {
+    Grow();
+    size_t hash = Hash(name);
+    Slot* slot = const_cast<Slot*>(Find(name, hash));
+    if (slot->name.data() != nullptr) return false;
+    *slot = Slot{ name, hash, 0 };
+    ++m_size;
+    return true;
+  }
+
+  uint32_t NameSet::Emplace(StringView name, uint32_t value)
+  {
+    Grow();
+    size_t hash = Hash(name);
+    Slot* slot = const_cast<Slot*>(Find(name, hash));
+    if (slot->name.data() != nullptr) return slot->value;
+    *slot = Slot{ name, hash, value };
+    ++m_size;
+    return value;
+  }
+
+  bool NameSet::Contains(StringView name) const
+  {
+    if (m_slots.empty()) return false;
+    return Find(name, Hash(name))->name.data() != nullptr;
+  }
+
+  bool NameSet::Erase(StringView name)
+  {
+    if (m_slots.empty()) return false;
+    size_t mask = m_slots.size() - 1;
+    size_t i = static_cast<size_t>(Find(name, Hash(name)) - m_slots.data());
+    if (m_slots[i].name.data() == nullptr) return false;
+    // no tombstones: pull back every later name of the run that may sit in the hole, so lookups still stop at a free slot
+    for (size_t j = (i + 1) & mask; m_slots[j].name.data() != nullptr; j = (j + 1) & mask)
+    {
+      size_t home = m_slots[j].hash & mask;
+      if (((j - home) & mask) >= ((j - i) & mask))
+      {
+        m_slots[i] = m_slots[j];
+        i = j;
+      }
+    }
+    m_slots[i] = Slot{ StringView{}, 0, 0 };
+    --m_size;
+    return true;
+  }
+
+  void NameSet::Clear()
+  {
+    std::fill(m_slots.begin(), m_slots.end(), Slot{ StringView{}, 0, 0 });   // keep the table for the next directory
+    m_size = 0;
+  }
+
+  NameHashes::NameHashes(bool ignoreCase, size_t limit) : m_ignoreCase(ignoreCase), m_limit(limit)
+  {
+    m_slots.assign(16, 0);
+  }
+
+  bool NameHashes::Full() const
+  {
+    return (m_size + 1) * 2 > m_slots.size() && m_slots.size() * 3 * sizeof(uint64_t) > m_limit;   // growing needs old + new table
+  }
+
+  bool NameHashes::Grow()
+  {
+    if (Full()) return false;
+    std::vector<uint64_t> old(m_slots.size() * 2, 0);
+    old.swap(m_slots);
+    size_t mask = m_slots.size() - 1;
+    for (uint64_t h : old)
+    {
+      if (h == 0) continue;
+      size_t i = static_cast<size_t>(h) & mask;
+      while (m_slots[i] != 0) i = (i + 1) & mask;
+      m_slots[i] = h;
+    }
+    return true;
+  }
+
+  bool NameHashes::Insert(StringView name)
+  {
+    if ((m_size + 1) * 2 > m_slots.size() && !Grow()) return false;   // keep the load factor at or below 1/2
+    uint64_t h = Fnv(name, m_ignoreCase) | 1;            // never 0, the free mark; costs one bit of the hash
+    size_t mask = m_slots.size() - 1;
+    size_t i = static_cast<size_t>(h) & mask;
+    for (; m_slots[i] != 0; i = (i + 1) & mask)
+    {
+      if (m_slots[i] == h) return false;
+    }
+    m_slots[i] = h;
+    ++m_size;
+    return true;
+  }
+
+  bool NameHashes::Contains(StringView name) const
+  {
+    uint64_t h = Fnv(name, m_ignoreCase) | 1;
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = static_cast<size_t>(h) & mask; m_slots[i] != 0; i = (i + 1) & mask)
+    {
+      if (m_slots[i] == h) return true;
+    }
+    return false;
+  }
+
+}
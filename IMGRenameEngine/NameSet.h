@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint32_t, uint64_t
+#include <vector>
+
+#include "Common.h"
+
+namespace Engine
+{
+
+  // Open addressing hash set of file names in one directory; the names themselves are not copied and must outlive the set.
+  // With ignoreCase, names that only differ in case are the same name, as on NTFS, exFAT and FAT cards.
+  class NameSet
+  {
+  public:
+    explicit NameSet(bool ignoreCase) : m_ignoreCase(ignoreCase) {}
+
+    void Reserve(size_t n);                              // size the table for n names, so inserting them never rehashes
+    bool Insert(StringView name);                        // false if the name (or a case variant) is already present
+    uint32_t Emplace(StringView name, uint32_t value);   // as a map: stores value with a new name, returns the value stored with name
+    bool Contains(StringView name) const;
+    bool Erase(StringView name);                         // false if the name is not present
+    bool Same(StringView a, StringView b) const;         // equal under this set's case rule
+    size_t Size() const { return m_size; }
+    void Clear();
+
+  private:
+    struct Slot
+    {
+      StringView name;                                   // empty data() = free slot
+      size_t hash;
+      uint32_t value;                                    // Emplace() only
+    };
+
+    size_t Hash(StringView name) const;
+    const Slot* Find(StringView name, size_t hash) const;
+    void Grow();
+
+  private:
+    bool m_ignoreCase;
+    std::vector<Slot> m_slots;                           // size is a power of two
+    size_t m_size{};
+  };
+
+  // The same for directories too big to keep their names around: a table of 64-bit name hashes, 8 bytes per slot at a
+  // load factor of at most 1/2. It grows by doubling as long as the old and the new table together fit in the byte
+  // limit, and never beyond. Two names with the same hash count as one; at 64 bits that is one in 10^19 pairs.
+  class NameHashes
+  {
+  public:
+    NameHashes(bool ignoreCase, size_t limit);           // limit: bytes the table may take, growing included
+
+    bool Insert(StringView name);                        // false if the name is already present, or the table is full
+    bool Contains(StringView name) const;
+    bool Full() const;                                   // no room for one more name
+    void Limit(size_t limit) { m_limit = limit; }        // a new byte limit, for the next time the table grows
+    size_t Bytes() const { return m_slots.capacity() * sizeof(uint64_t); }
+
+  private:
+    bool Grow();
+
+  private:
+    bool m_ignoreCase;
+    size_t m_limit;
+    std::vector<uint64_t> m_slots;                       // 0 = free; size is a power of two
+    size_t m_size{};
+  };
+
+}
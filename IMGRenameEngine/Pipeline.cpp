@@ -0,0 +1,189 @@
+#include <algorithm>        // For std::max
+
+#include "Pipeline.h"
+#include "Traversal.h"
+#include "WorkPool.h"
+
+namespace Engine
+{
+
+  static double Seconds(Pipeline::Clock::duration d)
+  {
+    return std::chrono::duration<double>(d).count();
+  }
+
+  Pipeline::Pipeline(size_t depth) : m_depth(depth)
+  {
+  }
+
+  Pipeline::~Pipeline()
+  {
+    Stop();
+  }
+
+  void Pipeline::Add(const char* name, unsigned threads, Work work)
+  {
+    auto stage = std::make_unique<Stage>();
+    stage->stats.name = name;
+    stage->stats.threads = std::max(threads, 1u);
+    stage->work = std::move(work);
+    if (!m_stages.empty()) stage->in = std::make_unique<BoundedQueue<Job*>>(m_depth);
+    m_stages.push_back(std::move(stage));
+  }
+
+  void Pipeline::Start()
+  {
+    for (size_t index = 1; index < m_stages.size(); ++index)
+    {
+      Stage& stage = *m_stages[index];
+      stage.running = stage.stats.threads;
+      for (unsigned i = 0; i < stage.stats.threads; ++i) stage.threads.emplace_back([this, index] { Worker(index); });
+    }
+  }
+
+  void Pipeline::Enumerated(const String& path, Listing&& listing, const Signature& signature, bool indexed, Clock::time_point started)
+  {
+    auto job = std::make_unique<Job>();
+    job->path = path;
+    job->listing = std::move(listing);
+    job->signature = signature;
+    job->indexed = indexed;
+
+    Stage& first = *m_stages.front();
+    {
+      std::lock_guard<std::mutex> guard(first.lock);
+      ++first.stats.directories;
+      first.stats.files += job->listing.files.size();
+      first.stats.busy += Seconds(Clock::now() - started);
+    }
+    m_stages[1]->in->Push(job.release());
+  }
+
+  void Pipeline::Worker(size_t index)
+  {
+    Stage& stage = *m_stages[index];
+    BoundedQueue<Job*>* out = index + 1 < m_stages.size() ? m_stages[index + 1]->in.get() : nullptr;
+    StageStats local{};
+    size_t waiting = 0;                                  // sum of the queue depths seen, for the mean
+
+    Job* job{};
+    while (stage.in->Pop(job))
+    {
+      size_t depth = stage.in->Size() + 1;               // including the one just taken
+      local.queueMax = std::max(local.queueMax, depth);
+      waiting += depth;
+      ++local.directories;
+      local.files += job->listing.files.size();
+
+      Clock::time_point start = Clock::now();
+      try
+      {
+        stage.work(*job);
+      }
+      catch (...)
+      {
+        // keep taking jobs, or the stages before this one would wait forever; Finish() rethrows
+        std::lock_guard<std::mutex> guard(m_lock);
+        if (!m_error) m_error = std::current_exception();
+        delete job;
+        continue;
+      }
+      local.busy += Seconds(Clock::now() - start);
+      if (out != nullptr) out->Push(job);
+      else delete job;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(stage.lock);
+      double total = static_cast<double>(stage.stats.directories) * stage.stats.queueMean + static_cast<double>(waiting);
+      stage.stats.directories += local.directories;
+      stage.stats.files += local.files;
+      stage.stats.busy += local.busy;
+      stage.stats.queueMax = std::max(stage.stats.queueMax, local.queueMax);
+      stage.stats.queueMean = stage.stats.directories > 0 ? total / static_cast<double>(stage.stats.directories) : 0.0;
+    }
+    if (--stage.running == 0 && out != nullptr) out->Close();   // the last one out closes the next queue
+  }
+
+  void Pipeline::Finish()
+  {
+    Stop();
+    if (m_error) std::rethrow_exception(m_error);
+  }
+
+  void Pipeline::Stop()
+  {
+    if (m_stages.size() > 1) m_stages[1]->in->Close();
+    for (auto& stage : m_stages)
+    {
+      for (std::thread& t : stage->threads) t.join();
+      stage->threads.clear();
+    }
+  }
+
+  std::vector<StageStats> Pipeline::Stats() const
+  {
+    std::vector<StageStats> stats{};
+    for (const auto& stage : m_stages) stats.push_back(stage->stats);
+    return stats;
+  }
+
+  Result Renamer::RunPipeline()
+  {
+    Pipeline::Clock::time_point start = Pipeline::Clock::now();
+    unsigned enumerators = m_options.subdir ? m_options.threads : 1;
+    if (enumerators == 0) enumerators = std::max(std::thread::hardware_concurrency(), 1u);
+
+    Pipeline pipeline(64);
+    pipeline.Add("enumerate", enumerators, nullptr);
+    pipeline.Add("read", m_options.readers, [this](Job& job)
+      {
+        if (Cancelled()) return;                         // the jobs still queued only pass through
+        String file{};
+        for (size_t i = 0; i < job.listing.files.size(); ++i)
+        {
+          StringView name = job.listing.files[i];
+          if (!NeedsMetadata(name)) continue;
+          if (job.metadata.empty()) job.metadata.resize(job.listing.files.size());
+          file.assign(job.path).append(1, Separator).append(name);
+          ReadMetadata(file, job.metadata[i]);
+        }
+      });
+    pipeline.Add("plan", 1, [this](Job& job)
+      {
+        if (Cancelled()) return;
+        if (PlanDirectory(job.path, job.listing, job.plan, job.metadata.empty() ? nullptr : &job.metadata) && job.indexed)
+          Settle(job.path, job.listing, job.signature);
+        job.plan.Sort();
+      });
+    pipeline.Add("apply", m_options.renamers, [this](Job& job)
+      {
+        if (!job.plan.Entries().empty()) ApplyDirectory(job.plan, 0, job.plan.Entries().size());
+      });
+
+    pipeline.Start();
+
+    Plan none{};                                         // ScanDirectory wants one; in a pipeline run the jobs carry their own
+    m_pipeline = &pipeline;
+    m_traversal = std::make_unique<Traversal>(m_options.oneFileSystem);
+    try
+    {
+      WorkPool pool(enumerators);
+      pool.Submit([this, &none, &pool] { ScanDirectory(m_options.path, none, &pool); });
+      pool.Wait();
+    }
+    catch (...)
+    {
+      m_pipeline = nullptr;
+      throw;                                             // ~Pipeline drains and stops the stages
+    }
+    m_pipeline = nullptr;
+    pipeline.Finish();
+
+    Result result = Collect();
+    result.stages = pipeline.Stats();
+    result.seconds = Seconds(Pipeline::Clock::now() - start);
+    return result;
+  }
+
+}
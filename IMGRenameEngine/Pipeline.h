@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <exception>        // For std::exception_ptr
+#include <functional>       // For std::function
+#include <memory>           // For std::unique_ptr
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Engine.h"
+#include "Exif.h"
+#include "Plan.h"
+#include "Platform.h"
+#include "Queue.h"
+
+namespace Engine
+{
+
+  // One directory on its way through the pipeline
+  struct Job
+  {
+    String path;
+    Listing listing;                                     // files sorted
+    Signature signature{};
+    bool indexed{};
+    std::vector<Exif> metadata;                          // parallel to listing.files once a reader has been there; empty if no rule needs EXIF
+    Plan plan{ 16 * 1024 };                              // this directory's renames only
+  };
+
+  // Stages connected by bounded queues of directories. Each stage runs on its own threads, so slow I/O in one stage
+  // doesn't stall the others: the next directories are enumerated and read while renames go on in this one.
+  // A full queue holds up the stage in front of it, which bounds memory whatever the size of the tree.
+  // The first stage has no threads of its own, its work comes in through Enumerated().
+  class Pipeline
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Work = std::function<void(Job&)>;
+
+    explicit Pipeline(size_t depth);                     // directories per queue
+    ~Pipeline();
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    void Add(const char* name, unsigned threads, Work work);     // append a stage; the first call names the enumeration stage (threads: informational, work unused)
+    void Start();                                        // start the threads of all stages
+    void Enumerated(const String& path, Listing&& listing, const Signature& signature, bool indexed, Clock::time_point started);   // thread safe; waits while the first queue is full
+    void Finish();                                       // enumeration is done: drain every stage and stop its threads; rethrows the first escaped exception
+    std::vector<StageStats> Stats() const;
+
+  private:
+    struct Stage
+    {
+      StageStats stats;
+      Work work;
+      std::unique_ptr<BoundedQueue<Job*>> in;            // nullptr for the first stage
+      std::vector<std::thread> threads;
+      std::atomic<unsigned> running{};
+      std::mutex lock;                                   // guards stats
+    };
+
+    void Worker(size_t index);
+    void Stop();
+
+  private:
+    size_t m_depth;
+    std::vector<std::unique_ptr<Stage>> m_stages;
+    std::mutex m_lock;                                   // guards m_error
+    std::exception_ptr m_error{};
+  };
+
+}
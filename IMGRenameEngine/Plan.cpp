@@ -0,0 +1,89 @@
+#include <algorithm>        // For std::sort
+#include <numeric>          // For std::iota
+
+#include "Plan.h"
+
+namespace Engine
+{
+
+  void Plan::Batch::Add(StringView from, StringView to, uint32_t group, StringView folder)
+  {
+    m_names.push_back(from);
+    m_names.push_back(to);
+    m_groups.push_back(group);
+    m_folders.push_back(folder);
+  }
+
+  void Plan::Batch::Clear()
+  {
+    m_names.clear();
+    m_groups.clear();
+    m_folders.clear();
+    m_arena.Clear();
+  }
+
+  void Plan::Add(StringView directory, Batch& batch, uint32_t tag)
+  {
+    if (batch.Empty()) return;
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    uint32_t index = static_cast<uint32_t>(m_directories.size());
+    m_directories.push_back(m_arena.Store(directory));
+    m_tags.push_back(tag);
+    for (size_t i = 0; i < batch.m_names.size(); i += 2)
+    {
+      StringView folder = batch.m_folders[i / 2];
+      uint32_t target = InPlace;
+      if (!folder.empty())
+      {
+        auto known = m_folderIndex.find(folder);
+        if (known != m_folderIndex.end()) target = known->second;
+        else
+        {
+          target = static_cast<uint32_t>(m_folders.size());
+          m_folders.push_back(m_arena.Store(folder));
+          m_folderIndex.emplace(m_folders.back(), target);
+        }
+      }
+      m_entries.push_back(PlanEntry{ index, batch.m_groups[i / 2], target, m_arena.Store(batch.m_names[i]), m_arena.Store(batch.m_names[i + 1]) });
+    }
+    batch.Clear();
+  }
+
+  void Plan::Remove(const std::vector<char>& drop)
+  {
+    size_t n = 0;
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+      if (!drop[i]) m_entries[n++] = m_entries[i];
+    }
+    m_entries.resize(n);                                 // the names stay in the arena until the plan goes
+  }
+
+  void Plan::Sort()
+  {
+    std::vector<uint32_t> order(m_directories.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return m_directories[a] < m_directories[b]; });
+
+    std::vector<uint32_t> rank(order.size());
+    std::vector<StringView> directories(order.size());
+    std::vector<uint32_t> tags(order.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+    {
+      rank[order[i]] = i;
+      directories[i] = m_directories[order[i]];
+      tags[i] = m_tags[order[i]];
+    }
+    m_directories.swap(directories);
+    m_tags.swap(tags);
+    for (PlanEntry& e : m_entries) e.directory = rank[e.directory];
+
+    std::sort(m_entries.begin(), m_entries.end(), [](const PlanEntry& a, const PlanEntry& b)
+      {
+        if (a.directory != b.directory) return a.directory < b.directory;
+        return a.group != b.group ? a.group < b.group : a.from < b.from;   // the members of a group stay together
+      });
+  }
+
+}
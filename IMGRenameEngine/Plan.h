@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint32_t
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Arena.h"
+
+namespace Engine
+{
+
+  struct PlanEntry
+  {
+    uint32_t directory;                                  // index into Plan::Directories()
+    uint32_t group;                                      // entries of a directory with the same group are renamed all or none
+    uint32_t folder;                                     // index into Plan::Folders() to move the file into, or Plan::InPlace
+    StringView from;                                     // current leaf name
+    StringView to;                                       // new leaf name
+  };
+
+  // The complete list of renames of a run, computed before anything on disk is touched.
+  // All names live in one arena, an entry is two views plus directory, group and folder numbers.
+  // Group numbers must follow the order of the groups' first names, so that sorting keeps name order.
+  class Plan
+  {
+  public:
+    static constexpr uint32_t InPlace = ~uint32_t{};     // PlanEntry::folder of a rename within its directory
+
+    // one directory's worth of renames; filled without locking, then handed to Plan::Add in one go
+    class Batch
+    {
+    public:
+      explicit Batch(size_t chunk = 4 * 1024) : m_arena(chunk) {}   // chunk: arena chunk in characters, at least a few of the longest new name
+      StringView Name(StringView prefix, StringView suffix, StringView tail = {}) { return m_arena.Concat(prefix, suffix, tail); }   // storage for a new name
+      void Add(StringView from, StringView to, uint32_t group, StringView folder = {});   // the views must stay valid until Plan::Add; group: see PlanEntry; folder: full path, empty = in place
+      bool Empty() const { return m_names.empty(); }
+      size_t Size() const { return m_names.size() / 2; }
+      void Clear();
+      size_t Bytes() const { return m_arena.Bytes() + m_names.capacity() * sizeof(StringView) + m_groups.capacity() * sizeof(uint32_t) + m_folders.capacity() * sizeof(StringView); }
+
+    private:
+      friend class Plan;
+      std::vector<StringView> m_names;                   // from, to, from, to, ...
+      std::vector<uint32_t> m_groups;                    // one per from, to pair
+      std::vector<StringView> m_folders;                 // one per from, to pair
+      Arena m_arena;
+    };
+
+    explicit Plan(size_t chunk = 1024 * 1024) : m_arena(chunk) {}   // chunk: arena chunk in characters, small for plans of one directory
+
+    void Add(StringView directory, Batch& batch, uint32_t tag = 0);   // thread safe; tag is the caller's id for the directory
+    void Remove(const std::vector<char>& drop);          // drop the entries flagged in drop, parallel to Entries(); keeps the order
+    void Sort();                                         // directories by path, entries by group, then name: reproducible order for preview and apply
+
+    const std::vector<StringView>& Directories() const { return m_directories; }
+    const std::vector<uint32_t>& Tags() const { return m_tags; }        // parallel to Directories()
+    const std::vector<StringView>& Folders() const { return m_folders; }   // where entries move to, each path once
+    const std::vector<PlanEntry>& Entries() const { return m_entries; }
+    size_t Bytes() const { return m_arena.Bytes() + m_entries.capacity() * sizeof(PlanEntry) + m_directories.capacity() * sizeof(StringView); }
+
+  private:
+    std::mutex m_lock;
+    Arena m_arena;
+    std::vector<StringView> m_directories;
+    std::vector<uint32_t> m_tags;
+    std::vector<StringView> m_folders;
+    std::unordered_map<StringView, uint32_t> m_folderIndex;   // path -> index into m_folders
+    std::vector<PlanEntry> m_entries;
+  };
+
+}
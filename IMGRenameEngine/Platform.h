@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For intptr_t, uint64_t
+#include <vector>           // For std::vector
+
+#include "Arena.h"
+#include "Rules.h"
+
+namespace Engine
+{
+
+  // Result of one directory enumeration, already split by what the engine does with each entry.
+  // File names live in the listing's own arena, so a listing costs a few allocations per directory, none per file.
+  struct Listing
+  {
+    std::vector<StringView> files;                       // rename candidates: non-directories whose name starts with one of the prefixes
+    std::vector<String> subdirs;                         // subdirectories to descend into (only collected when asked for)
+    std::vector<StringView> others;                      // every other name in the directory, a rename must not collide with these either
+    bool partial{};                                      // not a full listing: names not in here have to be looked up on disk
+    Arena names{ 16 * 1024 };                            // storage for files and others
+
+    void Clear() { files.clear(); subdirs.clear(); others.clear(); partial = false; names.Clear(); }
+  };
+
+  // Identity and last modification of a directory; equal signatures mean nothing was added, removed or renamed in it
+  struct Signature
+  {
+    uint64_t device{};                                   // st_dev / volume serial number
+    uint64_t inode{};                                    // st_ino / file index
+    uint64_t mtime{};                                    // last modification, in the platform's finest unit
+    uint64_t entries{};                                  // number of entries when it was listed; informational, stat can't tell
+
+    bool operator==(const Signature& o) const { return device == o.device && inode == o.inode && mtime == o.mtime; }
+  };
+
+  // Identity and version of a file: the same values mean the same, unmodified file, whatever its name is now
+  struct FileId
+  {
+    uint64_t device{};                                   // st_dev / volume serial number
+    uint64_t inode{};                                    // st_ino / file index
+    uint64_t size{};
+    uint64_t mtime{};                                    // last modification, in the platform's finest unit
+  };
+
+  // A file mapped into memory, read-only or read-write. Read-write files can be grown, which remaps them,
+  // so pointers into Data() don't survive a Resize().
+  class MappedFile
+  {
+  public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void Open(const String& path, bool write);           // write: create if missing; throws Error
+    void Resize(size_t size);                            // set the file size and remap; write mode only; throws Error
+    void Flush(bool wait);                               // push dirty pages towards the disk; wait = until they are there
+    void Flush(size_t begin, size_t end, bool wait);     // the same for the bytes [begin, end) only
+    void Close();
+    bool IsOpen() const { return m_file != -1; }
+
+    char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+  private:
+    void Map();
+    void Unmap();
+
+  private:
+    String m_path;
+    intptr_t m_file{ -1 };                               // file descriptor / HANDLE
+    void* m_mapping{};                                   // file mapping HANDLE (Windows only)
+    char* m_data{};
+    size_t m_size{};
+    bool m_write{};
+  };
+
+  // An open directory whose entries are renamed by leaf name, so the OS resolves the directory's path once
+  // instead of once per file. Where there are no *at() calls (Windows) it falls back to joining the names onto the path.
+  class Directory
+  {
+  public:
+    Directory() = default;
+    ~Directory() { Close(); }
+    Directory(const Directory&) = delete;
+    Directory& operator=(const Directory&) = delete;
+
+    void Open(const String& path);                       // throws Error
+    void Close();
+    int Handle() const { return static_cast<int>(m_file); }   // for *at() calls and io_uring; only valid after Open() on POSIX
+
+    void Rename(const Char* from, const Char* to);       // NUL terminated leaf names; never replaces an existing entry; throws Error
+    bool Exists(const Char* name);                       // true if the directory has an entry with that name
+    String Path(StringView name) const { String path{ m_path }; return path.append(name); }   // full path of an entry, for messages
+
+  private:
+    String m_path;                                       // directory path with trailing separator
+    intptr_t m_file{ -1 };                               // directory file descriptor (POSIX only)
+#ifdef _WIN32
+    String m_from;                                       // reused full path buffers, no allocation per file once they are large enough
+    String m_to;
+#endif
+  };
+
+  // A directory read a chunk at a time as the entries come off getdents64 / FindNextFile, for directories too big to
+  // list in one go: whatever the size of the directory, memory stays at one chunk
+  class DirectoryStream
+  {
+  public:
+    DirectoryStream() = default;
+    ~DirectoryStream() { Close(); }
+    DirectoryStream(const DirectoryStream&) = delete;
+    DirectoryStream& operator=(const DirectoryStream&) = delete;
+
+    void Open(const String& path);                       // throws Error
+    bool Next(const RuleSet& rules, bool subdirs, Listing& chunk, size_t entries);   // up to entries more, split up as by Scan(); false at the end; throws Error
+    void Close();
+    size_t Bytes() const { return m_buffer.capacity(); }   // memory held besides the chunks, fixed once open
+
+  private:
+    String m_path;
+    intptr_t m_file{ -1 };                               // directory file descriptor / find HANDLE
+    void* m_dir{};                                       // DIR* where there is no getdents64
+    std::vector<char> m_buffer;                          // getdents64 records / the pending WIN32_FIND_DATAW
+    size_t m_pos{};                                      // next record in m_buffer
+    size_t m_end{};                                      // end of the records in m_buffer
+  };
+
+  namespace Platform
+  {
+    void Scan(const String& path, const RuleSet& rules, bool subdirs, Listing& listing);  // enumerate path once, filling listing; throws Error if path can't be read
+    void Rename(const String& from, const String& to);                                   // rename a file, never replacing an existing one; throws Error
+    bool HasPrefix(StringView name, StringView prefix);                                   // prefix test with the platform's case rule, as RuleSet uses it
+    void Move(const String& from, const String& to);                                     // Rename(), or across file systems copy and delete; never replaces; throws Error
+    bool MakeDirectory(const String& path);                                              // true if made or already there, false if the parent is missing; throws Error
+    bool Exists(const String& path);                                                     // true if there is a file system entry with that name
+    String FullPath(const String& path);                                                 // path joined onto the current directory unless absolute; as it is if that can't be found
+    void Replace(const String& from, const String& to);                                  // rename, replacing an existing target; throws Error
+    bool Stat(const String& path, Signature& signature);                                 // signature of a directory, without listing it
+    bool Identify(const String& path, FileId& id);                                       // identity of a file, without reading it
+    String ReadText(const String& path);                                                 // whole UTF-8 text file in native characters; throws Error
+    size_t ReadHead(const String& path, void* buffer, size_t size);                      // first bytes of a file, one read; 0 if it can't be read
+    size_t ReadAt(const String& path, uint64_t offset, void* buffer, size_t size);       // bytes from offset on, one read; 0 if it can't be read
+  }
+
+}
@@ -0,0 +1,474 @@
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>          // For open(), AT_FDCWD
+#include <stdio.h>          // For rename(), renameat2()
+#include <string.h>         // For strerror(), strncmp()
+#include <sys/mman.h>       // For mmap()
+#include <sys/stat.h>
+#include <unistd.h>         // For close(), ftruncate(), fsync(), unlink(), sysconf(), getcwd()
+#ifdef __linux__
+#include <sys/syscall.h>    // For SYS_getdents64
+#endif
+
+#include <algorithm>        // For std::fill
+#include <cstddef>          // For offsetof
+#include <cstdint>          // For uint8_t
+
+#include "Platform.h"
+#include "Trace.h"
+
+namespace Engine
+{
+
+  static std::string Describe(const char* what, int code)
+  {
+    return std::string(what) + ": " + strerror(code);
+  }
+
+  void MappedFile::Open(const String& path, bool write)
+  {
+    Close();
+    int fd = ::open(path.c_str(), write ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+    if (fd < 0) throw Error(Describe("open", errno), path, errno);
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+      int code = errno;
+      ::close(fd);
+      throw Error(Describe("fstat", code), path, code);
+    }
+    m_path = path;
+    m_file = fd;
+    m_write = write;
+    m_size = static_cast<size_t>(st.st_size);
+    Map();
+  }
+
+  void MappedFile::Map()
+  {
+    if (m_size == 0) return;                             // mmap refuses empty mappings
+    void* p = ::mmap(nullptr, m_size, m_write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, static_cast<int>(m_file), 0);
+    if (p == MAP_FAILED) throw Error(Describe("mmap", errno), m_path, errno);
+    m_data = static_cast<char*>(p);
+  }
+
+  void MappedFile::Unmap()
+  {
+    if (m_data != nullptr) ::munmap(m_data, m_size);
+    m_data = nullptr;
+  }
+
+  void MappedFile::Resize(size_t size)
+  {
+    Unmap();
+    if (::ftruncate(static_cast<int>(m_file), static_cast<off_t>(size)) != 0) throw Error(Describe("ftruncate", errno), m_path, errno);
+    m_size = size;
+    Map();
+  }
+
+  void MappedFile::Flush(bool wait)
+  {
+    if (m_data != nullptr) ::msync(m_data, m_size, wait ? MS_SYNC : MS_ASYNC);
+  }
+
+  void MappedFile::Flush(size_t begin, size_t end, bool wait)
+  {
+    if (m_data == nullptr || begin >= end) return;
+    static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    begin &= ~(page - 1);                                // msync wants a page aligned start
+    ::msync(m_data + begin, (end < m_size ? end : m_size) - begin, wait ? MS_SYNC : MS_ASYNC);
+  }
+
+  void MappedFile::Close()
+  {
+    if (m_file == -1) return;
+    Unmap();
+    ::close(static_cast<int>(m_file));
+    m_file = -1;
+    m_size = 0;
+  }
+
+  void Directory::Open(const String& path)
+  {
+    Close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) throw Error(Describe("open", errno), path, errno);
+    m_file = fd;
+    m_path = path;
+    if (m_path.empty() || m_path.back() != Separator) m_path += Separator;
+  }
+
+  void Directory::Close()
+  {
+    if (m_file == -1) return;
+    ::close(static_cast<int>(m_file));
+    m_file = -1;
+  }
+
+  void Directory::Rename(const Char* from, const Char* to)
+  {
+    int fd = static_cast<int>(m_file);
+#ifdef RENAME_NOREPLACE
+    if (::renameat2(fd, from, fd, to, RENAME_NOREPLACE) == 0) return;
+    if (errno != EINVAL && errno != ENOSYS) throw Error(Describe("rename", errno), Path(from), errno);
+#endif
+    if (Exists(to)) throw Error(Describe("rename", EEXIST), Path(from), EEXIST);   // file system without RENAME_NOREPLACE support
+    if (::renameat(fd, from, fd, to) != 0) throw Error(Describe("rename", errno), Path(from), errno);
+  }
+
+  bool Directory::Exists(const Char* name)
+  {
+    struct stat st;
+    return ::fstatat(static_cast<int>(m_file), name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+  }
+
+  namespace Platform
+  {
+
+    bool HasPrefix(StringView name, StringView prefix)
+    {
+      return name.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    static bool IsDots(const char* name)
+    {
+      return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+    }
+
+    // sort the dots and directories of a listing away; true for anything else, which is up to the rules.
+    // d_type lets us do that without a stat for almost every entry. A symbolic link to a directory is a directory,
+    // as a junction is on Windows: the walk enters what it leads to once, however many links lead there
+    static bool Sort(int fd, const char* name, unsigned char type, bool subdirs, Listing& listing)
+    {
+      if (IsDots(name)) return false;
+      if (type == DT_UNKNOWN)                            // some file systems don't fill d_type
+      {
+        struct stat st;
+        if (::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return false;   // vanished meanwhile
+        type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK : DT_REG;
+      }
+      if (type == DT_LNK)
+      {
+        struct stat st;
+        if (::fstatat(fd, name, &st, 0) == 0 && S_ISDIR(st.st_mode)) type = DT_DIR;   // a dangling link stays a name like any other
+      }
+      if (type != DT_DIR) return true;
+      if (subdirs) listing.subdirs.emplace_back(name);
+      else listing.others.push_back(listing.names.Store(name));
+      return false;
+    }
+
+    // sort one entry into the listing
+    static void Classify(int fd, const char* name, unsigned char type, const RuleSet& rules, bool subdirs, Listing& listing)
+    {
+      if (!Sort(fd, name, type, subdirs, listing)) return;
+      if (rules.Match(name) != nullptr) listing.files.push_back(listing.names.Store(name));
+      else listing.others.push_back(listing.names.Store(name));
+    }
+
+#ifdef __linux__
+
+    struct LinuxDirent64                                 // layout of the records returned by getdents64
+    {
+      ino64_t        d_ino;
+      off64_t        d_off;
+      unsigned short d_reclen;
+      unsigned char  d_type;
+      char           d_name[1];
+    };
+
+    void Scan(const String& path, const RuleSet& rules, bool subdirs, Listing& listing)
+    {
+      listing.Clear();
+      int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (fd < 0) throw Error(Describe("open", errno), path, errno);
+
+      // one syscall returns hundreds of entries; the 16 bytes behind them let the batch prefix test load any name whole
+      static constexpr size_t Size = 64 * 1024;
+      static constexpr size_t MostEntries = Size / offsetof(LinuxDirent64, d_name);
+      alignas(LinuxDirent64) char buffer[Size + 16];
+      std::fill(buffer + Size, buffer + Size + 16, '\0');
+      const char* names[MostEntries];                    // the entries of one buffer the rules decide on
+      uint8_t matches[MostEntries];
+      for (;;)
+      {
+        long n{};
+        {
+          Span span("getdents");
+          n = ::syscall(SYS_getdents64, fd, buffer, Size);
+        }
+        if (n == 0) break;
+        if (n < 0)
+        {
+          int code = errno;
+          ::close(fd);
+          throw Error(Describe("getdents64", code), path, code);
+        }
+        Span span("match");
+        size_t count = 0;
+        for (long pos = 0; pos < n;)
+        {
+          const LinuxDirent64* e = reinterpret_cast<const LinuxDirent64*>(buffer + pos);
+          if (Sort(fd, e->d_name, e->d_type, subdirs, listing)) names[count++] = e->d_name;
+          pos += e->d_reclen;
+        }
+        rules.Match(names, count, matches);
+        for (size_t i = 0; i < count; ++i) (matches[i] ? listing.files : listing.others).push_back(listing.names.Store(names[i]));
+      }
+      ::close(fd);
+    }
+
+#else
+
+    void Scan(const String& path, const RuleSet& rules, bool subdirs, Listing& listing)
+    {
+      listing.Clear();
+      DIR* dir = ::opendir(path.c_str());
+      if (dir == nullptr) throw Error(Describe("opendir", errno), path, errno);
+
+      while (const dirent* e = ::readdir(dir))
+      {
+        Classify(::dirfd(dir), e->d_name, e->d_type, rules, subdirs, listing);
+      }
+      ::closedir(dir);
+    }
+
+#endif // __linux__
+
+    void Rename(const String& from, const String& to)
+    {
+      // rename() silently replaces an existing target, unlike MoveFile on Windows
+#ifdef RENAME_NOREPLACE
+      if (::renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), RENAME_NOREPLACE) == 0) return;
+      if (errno != EINVAL && errno != ENOSYS) throw Error(Describe("rename", errno), from, errno);
+#endif
+      struct stat st;                                    // file system without RENAME_NOREPLACE support
+      if (::lstat(to.c_str(), &st) == 0) throw Error(Describe("rename", EEXIST), from, EEXIST);
+      if (::rename(from.c_str(), to.c_str()) != 0) throw Error(Describe("rename", errno), from, errno);
+    }
+
+    // copy a file to a new name on another file system, with its permissions and modification time, and flushed to
+    // disk: the caller deletes the original next. A partial copy is removed again
+    static void CopyFile(const String& from, const String& to)
+    {
+      int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+      if (in < 0) throw Error(Describe("open", errno), from, errno);
+      struct stat st;
+      int out = ::fstat(in, &st) == 0 ? ::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777) : -1;
+      if (out < 0)
+      {
+        int code = errno;
+        ::close(in);
+        throw Error(Describe("open", code), to, code);
+      }
+
+      std::vector<char> buffer(1024 * 1024);
+      int code = 0;
+      for (;;)
+      {
+        ssize_t n = ::read(in, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+        {
+          if (n < 0) code = errno;
+          break;
+        }
+        for (ssize_t done = 0; done < n && code == 0;)
+        {
+          ssize_t w = ::write(out, buffer.data() + done, static_cast<size_t>(n - done));
+          if (w < 0 && errno != EINTR) code = errno;
+          else if (w > 0) done += w;
+        }
+        if (code != 0) break;
+      }
+#ifdef __APPLE__
+      struct timespec times[2]{ st.st_atimespec, st.st_mtimespec };
+#else
+      struct timespec times[2]{ st.st_atim, st.st_mtim };
+#endif
+      if (code == 0 && ::futimens(out, times) != 0) code = errno;
+      if (code == 0 && ::fsync(out) != 0) code = errno;
+      if (::close(out) != 0 && code == 0) code = errno;
+      ::close(in);
+      if (code == 0) return;
+      ::unlink(to.c_str());
+      throw Error(Describe("copy", code), from, code);
+    }
+
+    void Move(const String& from, const String& to)
+    {
+      try
+      {
+        Rename(from, to);
+        return;
+      }
+      catch (const Error& e)
+      {
+        if (e.Code() != EXDEV) throw;
+      }
+      CopyFile(from, to);
+      if (::unlink(from.c_str()) != 0)
+      {
+        int code = errno;
+        ::unlink(to.c_str());                            // one file, not two
+        throw Error(Describe("unlink", code), from, code);
+      }
+    }
+
+    bool MakeDirectory(const String& path)
+    {
+      if (::mkdir(path.c_str(), 0777) == 0 || errno == EEXIST) return true;
+      if (errno == ENOENT) return false;
+      throw Error(Describe("mkdir", errno), path, errno);
+    }
+
+    bool Exists(const String& path)
+    {
+      struct stat st;
+      return ::lstat(path.c_str(), &st) == 0;
+    }
+
+    String FullPath(const String& path)
+    {
+      if (!path.empty() && path[0] == '/') return path;
+      char cwd[4096];
+      if (::getcwd(cwd, sizeof(cwd)) == nullptr) return path;
+      String full(cwd);
+      StringView rest(path);
+      while (rest.size() >= 2 && rest[0] == '.' && rest[1] == '/') rest.remove_prefix(2);   // "./photos" -> "photos"
+      if (rest == ".") rest = {};
+      if (!rest.empty() && full.back() != '/') full += '/';
+      return full.append(rest);
+    }
+
+    void Replace(const String& from, const String& to)
+    {
+      if (::rename(from.c_str(), to.c_str()) != 0) throw Error(Describe("rename", errno), from, errno);
+    }
+
+    bool Stat(const String& path, Signature& signature)
+    {
+      struct stat st;
+      if (::stat(path.c_str(), &st) != 0) return false;
+      signature.device = static_cast<uint64_t>(st.st_dev);
+      signature.inode = static_cast<uint64_t>(st.st_ino);
+#ifdef __APPLE__
+      signature.mtime = static_cast<uint64_t>(st.st_mtimespec.tv_sec) * 1000000000u + st.st_mtimespec.tv_nsec;
+#else
+      signature.mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000u + st.st_mtim.tv_nsec;
+#endif
+      return true;
+    }
+
+    bool Identify(const String& path, FileId& id)
+    {
+      struct stat st;
+      if (::stat(path.c_str(), &st) != 0) return false;
+      id.device = static_cast<uint64_t>(st.st_dev);
+      id.inode = static_cast<uint64_t>(st.st_ino);
+      id.size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+      id.mtime = static_cast<uint64_t>(st.st_mtimespec.tv_sec) * 1000000000u + st.st_mtimespec.tv_nsec;
+#else
+      id.mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000u + st.st_mtim.tv_nsec;
+#endif
+      return true;
+    }
+
+    size_t ReadHead(const String& path, void* buffer, size_t size)
+    {
+      return ReadAt(path, 0, buffer, size);
+    }
+
+    size_t ReadAt(const String& path, uint64_t offset, void* buffer, size_t size)
+    {
+      int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) return 0;
+      ssize_t n = ::pread(fd, buffer, size, static_cast<off_t>(offset));
+      ::close(fd);
+      return n < 0 ? 0 : static_cast<size_t>(n);
+    }
+
+    String ReadText(const String& path)
+    {
+      MappedFile file{};
+      file.Open(path, false);
+      size_t bom = file.Size() >= 3 && memcmp(file.Data(), "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+      return String(file.Data() + bom, file.Size() - bom);   // UTF-8 is the native encoding already
+    }
+
+  }
+
+  void DirectoryStream::Open(const String& path)
+  {
+    Close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) throw Error(Describe("open", errno), path, errno);
+    m_path = path;
+    m_file = fd;
+#ifdef __linux__
+    m_buffer.resize(64 * 1024);
+#else
+    m_dir = ::fdopendir(fd);                             // owns fd from now on
+    if (m_dir == nullptr)
+    {
+      int code = errno;
+      ::close(fd);
+      m_file = -1;
+      throw Error(Describe("fdopendir", code), path, code);
+    }
+#endif
+  }
+
+  bool DirectoryStream::Next(const RuleSet& rules, bool subdirs, Listing& chunk, size_t entries)
+  {
+    chunk.Clear();
+    if (m_file == -1) return false;
+    int fd = static_cast<int>(m_file);
+    size_t count = 0;
+    while (count < entries)
+    {
+#ifdef __linux__
+      if (m_pos == m_end)
+      {
+        long n{};
+        {
+          Span span("getdents");
+          n = ::syscall(SYS_getdents64, fd, m_buffer.data(), m_buffer.size());
+        }
+        if (n < 0) throw Error(Describe("getdents64", errno), m_path, errno);
+        if (n == 0) break;
+        m_pos = 0;
+        m_end = static_cast<size_t>(n);
+      }
+      const Platform::LinuxDirent64* e = reinterpret_cast<const Platform::LinuxDirent64*>(m_buffer.data() + m_pos);
+      m_pos += e->d_reclen;
+#else
+      errno = 0;
+      const dirent* e = ::readdir(static_cast<DIR*>(m_dir));
+      if (e == nullptr)
+      {
+        if (errno != 0) throw Error(Describe("readdir", errno), m_path, errno);
+        break;
+      }
+#endif
+      Platform::Classify(fd, e->d_name, e->d_type, rules, subdirs, chunk);
+      ++count;
+    }
+    return count > 0;
+  }
+
+  void DirectoryStream::Close()
+  {
+    if (m_file == -1) return;
+    if (m_dir != nullptr) ::closedir(static_cast<DIR*>(m_dir));
+    else ::close(static_cast<int>(m_file));
+    m_dir = nullptr;
+    m_file = -1;
+    m_pos = m_end = 0;
+  }
+}
+
+#endif // _WIN32
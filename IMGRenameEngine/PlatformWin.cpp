@@ -0,0 +1,369 @@
+#ifdef _WIN32
+
+#include <Windows.h>
+#include <string.h>          // For memcmp()
+#include <wchar.h>           // For wcscmp(), _wcsnicmp()
+
+#include "Platform.h"
+
+namespace Engine
+{
+
+  static std::string Describe(const char* what, DWORD code)
+  {
+    return std::string(what) + " failed, error " + std::to_string(code);
+  }
+
+  void MappedFile::Open(const String& path, bool write)
+  {
+    Close();
+    HANDLE h = ::CreateFileW(path.c_str(), write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr,
+      write ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE)
+    {
+      DWORD code = ::GetLastError();
+      throw Error(Describe("CreateFile", code), path, code);
+    }
+    LARGE_INTEGER size{};
+    ::GetFileSizeEx(h, &size);
+    m_path = path;
+    m_file = reinterpret_cast<intptr_t>(h);
+    m_write = write;
+    m_size = static_cast<size_t>(size.QuadPart);
+    Map();
+  }
+
+  void MappedFile::Map()
+  {
+    if (m_size == 0) return;                             // empty files can't be mapped
+    HANDLE mapping = ::CreateFileMappingW(reinterpret_cast<HANDLE>(m_file), nullptr, m_write ? PAGE_READWRITE : PAGE_READONLY,
+      static_cast<DWORD>(static_cast<unsigned long long>(m_size) >> 32), static_cast<DWORD>(m_size), nullptr);
+    if (mapping == nullptr)
+    {
+      DWORD code = ::GetLastError();
+      throw Error(Describe("CreateFileMapping", code), m_path, code);
+    }
+    void* p = ::MapViewOfFile(mapping, m_write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, m_size);
+    if (p == nullptr)
+    {
+      DWORD code = ::GetLastError();
+      ::CloseHandle(mapping);
+      throw Error(Describe("MapViewOfFile", code), m_path, code);
+    }
+    m_mapping = mapping;
+    m_data = static_cast<char*>(p);
+  }
+
+  void MappedFile::Unmap()
+  {
+    if (m_data != nullptr) ::UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) ::CloseHandle(m_mapping);
+    m_data = nullptr;
+    m_mapping = nullptr;
+  }
+
+  void MappedFile::Resize(size_t size)
+  {
+    Unmap();
+    LARGE_INTEGER end{};
+    end.QuadPart = static_cast<LONGLONG>(size);
+    if (!::SetFilePointerEx(reinterpret_cast<HANDLE>(m_file), end, nullptr, FILE_BEGIN) || !::SetEndOfFile(reinterpret_cast<HANDLE>(m_file)))
+    {
+      DWORD code = ::GetLastError();
+      throw Error(Describe("SetEndOfFile", code), m_path, code);
+    }
+    m_size = size;
+    Map();
+  }
+
+  void MappedFile::Flush(bool wait)
+  {
+    if (m_data == nullptr) return;
+    ::FlushViewOfFile(m_data, 0);
+    if (wait) ::FlushFileBuffers(reinterpret_cast<HANDLE>(m_file));
+  }
+
+  void MappedFile::Flush(size_t begin, size_t end, bool wait)
+  {
+    if (m_data == nullptr || begin >= end) return;
+    ::FlushViewOfFile(m_data + begin, (end < m_size ? end : m_size) - begin);
+    if (wait) ::FlushFileBuffers(reinterpret_cast<HANDLE>(m_file));
+  }
+
+  void MappedFile::Close()
+  {
+    if (m_file == -1) return;
+    Unmap();
+    ::CloseHandle(reinterpret_cast<HANDLE>(m_file));
+    m_file = -1;
+    m_size = 0;
+  }
+
+  void Directory::Open(const String& path)
+  {
+    m_path = path;
+    if (m_path.empty() || m_path.back() != Separator) m_path += Separator;
+  }
+
+  void Directory::Close()
+  {
+    m_path.clear();
+  }
+
+  void Directory::Rename(const Char* from, const Char* to)
+  {
+    m_from.assign(m_path).append(from);
+    m_to.assign(m_path).append(to);
+    Platform::Rename(m_from, m_to);
+  }
+
+  bool Directory::Exists(const Char* name)
+  {
+    m_from.assign(m_path).append(name);
+    return Platform::Exists(m_from);
+  }
+
+  namespace Platform
+  {
+
+    bool HasPrefix(StringView name, StringView prefix)
+    {
+      return name.size() >= prefix.size() && _wcsnicmp(name.data(), prefix.data(), prefix.size()) == 0;   // Windows file names are case-insensitive
+    }
+
+    // sort one entry into the listing
+    static void Classify(const WIN32_FIND_DATAW& data, const RuleSet& rules, bool subdirs, Listing& listing)
+    {
+      bool directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+      if (directory && (wcscmp(data.cFileName, L".") == 0 || wcscmp(data.cFileName, L"..") == 0))
+      {
+        // neither a candidate nor a possible collision
+      }
+      else if (directory && subdirs)
+      {
+        listing.subdirs.emplace_back(data.cFileName);
+      }
+      else if (!directory && rules.Match(data.cFileName) != nullptr)
+      {
+        listing.files.push_back(listing.names.Store(data.cFileName));
+      }
+      else
+      {
+        listing.others.push_back(listing.names.Store(data.cFileName));
+      }
+    }
+
+    void Scan(const String& path, const RuleSet& rules, bool subdirs, Listing& listing)
+    {
+      listing.Clear();
+      String pattern = path + Separator + L"*";
+      WIN32_FIND_DATAW data;
+
+      // FindExInfoBasic skips the 8.3 short names, FIND_FIRST_EX_LARGE_FETCH asks for bigger batches per round trip
+      HANDLE h = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+      if (h == INVALID_HANDLE_VALUE)
+      {
+        DWORD code = ::GetLastError();
+        if (code == ERROR_FILE_NOT_FOUND) return;         // valid directory, just empty
+        throw Error(Describe("FindFirstFile", code), path, code);
+      }
+      BOOL more = TRUE;
+      while (more)
+      {
+        Classify(data, rules, subdirs, listing);
+        more = ::FindNextFileW(h, &data);
+      }
+      ::FindClose(h);
+    }
+
+    void Rename(const String& from, const String& to)
+    {
+      if (!::MoveFileW(from.c_str(), to.c_str()))      // MoveFile never replaces an existing target
+      {
+        DWORD code = ::GetLastError();
+        throw Error(Describe("MoveFile", code), from, code);
+      }
+    }
+
+    void Move(const String& from, const String& to)
+    {
+      // without MOVEFILE_REPLACE_EXISTING an existing target is an error; across volumes, Windows copies and deletes
+      if (!::MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_COPY_ALLOWED | MOVEFILE_WRITE_THROUGH))
+      {
+        DWORD code = ::GetLastError();
+        throw Error(Describe("MoveFileEx", code), from, code);
+      }
+    }
+
+    bool MakeDirectory(const String& path)
+    {
+      if (::CreateDirectoryW(path.c_str(), nullptr)) return true;
+      DWORD code = ::GetLastError();
+      if (code == ERROR_ALREADY_EXISTS) return true;
+      if (code == ERROR_PATH_NOT_FOUND) return false;
+      throw Error(Describe("CreateDirectory", code), path, code);
+    }
+
+    bool Exists(const String& path)
+    {
+      return ::GetFileAttributesW(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+    }
+
+    String FullPath(const String& path)
+    {
+      DWORD size = ::GetFullPathNameW(path.c_str(), 0, nullptr, nullptr);
+      if (size == 0) return path;
+      String full(size, L'\0');
+      DWORD length = ::GetFullPathNameW(path.c_str(), size, &full[0], nullptr);
+      if (length == 0 || length >= size) return path;
+      full.resize(length);
+      return full;
+    }
+
+    void Replace(const String& from, const String& to)
+    {
+      if (!::MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING))
+      {
+        DWORD code = ::GetLastError();
+        throw Error(Describe("MoveFileEx", code), from, code);
+      }
+    }
+
+    bool Stat(const String& path, Signature& signature)
+    {
+      // FILE_FLAG_BACKUP_SEMANTICS is needed to open a directory
+      HANDLE h = ::CreateFileW(path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+      if (h == INVALID_HANDLE_VALUE) return false;
+      BY_HANDLE_FILE_INFORMATION info{};
+      BOOL ok = ::GetFileInformationByHandle(h, &info);
+      ::CloseHandle(h);
+      if (!ok) return false;
+      signature.device = info.dwVolumeSerialNumber;
+      signature.inode = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+      signature.mtime = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+      return true;
+    }
+
+    bool Identify(const String& path, FileId& id)
+    {
+      HANDLE h = ::CreateFileW(path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, 0, nullptr);
+      if (h == INVALID_HANDLE_VALUE) return false;
+      BY_HANDLE_FILE_INFORMATION info{};
+      BOOL ok = ::GetFileInformationByHandle(h, &info);
+      ::CloseHandle(h);
+      if (!ok) return false;
+      id.device = info.dwVolumeSerialNumber;
+      id.inode = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+      id.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+      id.mtime = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+      return true;
+    }
+
+    size_t ReadHead(const String& path, void* buffer, size_t size)
+    {
+      HANDLE h = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+      if (h == INVALID_HANDLE_VALUE) return 0;
+      DWORD n = 0;
+      if (!::ReadFile(h, buffer, static_cast<DWORD>(size), &n, nullptr)) n = 0;
+      ::CloseHandle(h);
+      return n;
+    }
+
+    size_t ReadAt(const String& path, uint64_t offset, void* buffer, size_t size)
+    {
+      HANDLE h = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+      if (h == INVALID_HANDLE_VALUE) return 0;
+      OVERLAPPED at{};                                   // on a synchronous handle, only the offset
+      at.Offset = static_cast<DWORD>(offset);
+      at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+      DWORD n = 0;
+      if (!::ReadFile(h, buffer, static_cast<DWORD>(size), &n, &at)) n = 0;
+      ::CloseHandle(h);
+      return n;
+    }
+
+    String ReadText(const String& path)
+    {
+      MappedFile file{};
+      file.Open(path, false);
+      const char* data = file.Data();
+      int size = static_cast<int>(file.Size());
+      if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)   // Notepad's byte order mark
+      {
+        data += 3;
+        size -= 3;
+      }
+      if (size == 0) return String{};
+      int n = ::MultiByteToWideChar(CP_UTF8, 0, data, size, nullptr, 0);
+      if (n == 0)
+      {
+        DWORD code = ::GetLastError();
+        throw Error(Describe("MultiByteToWideChar", code), path, code);
+      }
+      String text(static_cast<size_t>(n), L'\0');
+      ::MultiByteToWideChar(CP_UTF8, 0, data, size, &text[0], n);
+      return text;
+    }
+
+  }
+
+  void DirectoryStream::Open(const String& path)
+  {
+    Close();
+    String pattern = path + Separator + L"*";
+    m_buffer.resize(sizeof(WIN32_FIND_DATAW));
+    WIN32_FIND_DATAW* data = reinterpret_cast<WIN32_FIND_DATAW*>(m_buffer.data());
+    HANDLE h = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    m_path = path;
+    m_pos = m_end = 0;
+    if (h == INVALID_HANDLE_VALUE)
+    {
+      DWORD code = ::GetLastError();
+      if (code == ERROR_FILE_NOT_FOUND) return;           // valid directory, just empty: Next() finds nothing
+      throw Error(Describe("FindFirstFile", code), path, code);
+    }
+    m_file = reinterpret_cast<intptr_t>(h);
+    m_end = 1;                                           // FindFirstFile already returned the first entry
+  }
+
+  bool DirectoryStream::Next(const RuleSet& rules, bool subdirs, Listing& chunk, size_t entries)
+  {
+    chunk.Clear();
+    if (m_file == -1) return false;
+    HANDLE h = reinterpret_cast<HANDLE>(m_file);
+    WIN32_FIND_DATAW* data = reinterpret_cast<WIN32_FIND_DATAW*>(m_buffer.data());
+    size_t count = 0;
+    while (count < entries)
+    {
+      if (m_pos == m_end)
+      {
+        if (!::FindNextFileW(h, data))
+        {
+          DWORD code = ::GetLastError();
+          if (code != ERROR_NO_MORE_FILES) throw Error(Describe("FindNextFile", code), m_path, code);
+          break;
+        }
+        m_pos = 0;
+        m_end = 1;
+      }
+      Platform::Classify(*data, rules, subdirs, chunk);
+      m_pos = m_end;
+      ++count;
+    }
+    return count > 0;
+  }
+
+  void DirectoryStream::Close()
+  {
+    if (m_file == -1) return;
+    ::FindClose(reinterpret_cast<HANDLE>(m_file));
+    m_file = -1;
+    m_pos = m_end = 0;
+  }
+}
+
+#endif // _WIN32
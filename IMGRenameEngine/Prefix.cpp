@@ -0,0 +1,173 @@
+#include <algorithm>        // For std::min, std::copy
+
+#include "Prefix.h"
+
+namespace Engine
+{
+
+  static constexpr size_t Lanes = 16 / sizeof(Char);   // characters per 128 bit vector
+
+  static inline Char FoldAscii(Char c)
+  {
+    return c >= IMG_TEXT('a') && c <= IMG_TEXT('z') ? static_cast<Char>(c - IMG_TEXT('a') + IMG_TEXT('A')) : c;
+  }
+
+  PrefixMatcher::PrefixMatcher(StringView prefix, bool fold) : m_prefix(prefix), m_fold(fold)
+  {
+    if (m_fold)
+    {
+      for (Char& c : m_prefix) c = FoldAscii(c);
+    }
+#ifdef IMG_SSE2
+    Char lanes[Lanes]{};
+    size_t n = std::min(m_prefix.size(), Lanes);
+    std::copy(m_prefix.begin(), m_prefix.begin() + n, lanes);
+    m_vector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+    m_mask = n == Lanes ? 0xFFFFu : (1u << (n * sizeof(Char))) - 1;
+#endif
+  }
+
+  bool PrefixMatcher::MatchScalar(StringView name) const
+  {
+    if (name.size() < m_prefix.size()) return false;
+    for (size_t i = 0; i < m_prefix.size(); ++i)
+    {
+      Char c = m_fold ? FoldAscii(name[i]) : name[i];
+      if (c != m_prefix[i]) return false;
+    }
+    return true;
+  }
+
+  // prefix from position from on against a NUL terminated name; the NUL ends a name that is too short as a mismatch
+  static inline bool Rest(const String& prefix, bool fold, const Char* name, size_t from)
+  {
+    for (size_t i = from; i < prefix.size(); ++i)
+    {
+      Char c = fold ? FoldAscii(name[i]) : name[i];
+      if (c != prefix[i]) return false;
+    }
+    return true;
+  }
+
+#ifdef IMG_SSE2
+
+  // 'a'..'z' -> 'A'..'Z' in every lane: subtract 'a', lanes that end up in 0..25 were lower case letters
+  static inline __m128i FoldAscii(__m128i v)
+  {
+    if constexpr (sizeof(Char) == 2)
+    {
+      __m128i t = _mm_sub_epi16(v, _mm_set1_epi16('a'));
+      __m128i lower = _mm_and_si128(_mm_cmpgt_epi16(t, _mm_set1_epi16(-1)), _mm_cmplt_epi16(t, _mm_set1_epi16(26)));
+      return _mm_sub_epi16(v, _mm_and_si128(lower, _mm_set1_epi16(0x20)));
+    }
+    else
+    {
+      __m128i t = _mm_sub_epi8(v, _mm_set1_epi8('a'));
+      __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(t, _mm_set1_epi8(-1)), _mm_cmplt_epi8(t, _mm_set1_epi8(26)));
+      return _mm_sub_epi8(v, _mm_and_si128(lower, _mm_set1_epi8(0x20)));
+    }
+  }
+
+  static inline unsigned Equal(__m128i a, __m128i b)
+  {
+    if constexpr (sizeof(Char) == 2) return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(a, b)));
+    else return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+  }
+
+  bool PrefixMatcher::Match(StringView name) const
+  {
+    if (name.size() < m_prefix.size()) return false;
+
+    // never read past the end of the name: a whole vector where the name fills one, otherwise the low half where
+    // that holds the prefix (IMG_1234.JPG against IMG_), and the loop for the rest; lanes not loaded are masked off
+    __m128i v;
+    if (name.size() >= Lanes) v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(name.data()));
+    else if (name.size() >= Lanes / 2 && m_prefix.size() <= Lanes / 2) v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(name.data()));
+    else return MatchScalar(name);
+    if (m_fold) v = FoldAscii(v);
+    if ((Equal(v, m_vector) & m_mask) != m_mask) return false;
+    for (size_t i = Lanes; i < m_prefix.size(); ++i)    // prefixes longer than one vector
+    {
+      Char c = m_fold ? FoldAscii(name[i]) : name[i];
+      if (c != m_prefix[i]) return false;
+    }
+    return true;
+  }
+
+#ifdef IMG_AVX2
+
+  static inline __m256i FoldAscii(__m256i v)
+  {
+    if constexpr (sizeof(Char) == 2)
+    {
+      __m256i t = _mm256_sub_epi16(v, _mm256_set1_epi16('a'));
+      __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi16(t, _mm256_set1_epi16(-1)), _mm256_cmpgt_epi16(_mm256_set1_epi16(26), t));
+      return _mm256_sub_epi16(v, _mm256_and_si256(lower, _mm256_set1_epi16(0x20)));
+    }
+    else
+    {
+      __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8('a'));
+      __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(t, _mm256_set1_epi8(-1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(26), t));
+      return _mm256_sub_epi8(v, _mm256_and_si256(lower, _mm256_set1_epi8(0x20)));
+    }
+  }
+
+  static inline unsigned Equal(__m256i a, __m256i b)
+  {
+    if constexpr (sizeof(Char) == 2) return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(a, b)));
+    else return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+  }
+
+#endif
+
+  size_t PrefixMatcher::Match(const Char* const* names, size_t count, uint8_t* matches) const
+  {
+    size_t n = 0;
+    size_t i = 0;
+#ifdef IMG_AVX2
+    // two names per 256 bit vector, one in each half
+    const __m256i prefix = _mm256_broadcastsi128_si256(m_vector);
+    for (; i + 2 <= count; i += 2)
+    {
+      __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(names[i]))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(names[i + 1])), 1);
+      if (m_fold) v = FoldAscii(v);
+      unsigned equal = Equal(v, prefix);
+      bool first = (equal & m_mask) == m_mask && Rest(m_prefix, m_fold, names[i], Lanes);
+      bool second = (equal >> 16 & m_mask) == m_mask && Rest(m_prefix, m_fold, names[i + 1], Lanes);
+      matches[i] = first ? 1 : 0;
+      matches[i + 1] = second ? 1 : 0;
+      n += matches[i] + matches[i + 1];
+    }
+#endif
+    for (; i < count; ++i)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(names[i]));
+      if (m_fold) v = FoldAscii(v);
+      matches[i] = (Equal(v, m_vector) & m_mask) == m_mask && Rest(m_prefix, m_fold, names[i], Lanes) ? 1 : 0;
+      n += matches[i];
+    }
+    return n;
+  }
+
+#else
+
+  bool PrefixMatcher::Match(StringView name) const
+  {
+    return MatchScalar(name);
+  }
+
+  size_t PrefixMatcher::Match(const Char* const* names, size_t count, uint8_t* matches) const
+  {
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      matches[i] = Rest(m_prefix, m_fold, names[i], 0) ? 1 : 0;
+      n += matches[i];
+    }
+    return n;
+  }
+
+#endif
+
+}
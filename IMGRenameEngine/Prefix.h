@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint8_t
+
+#include "Common.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMG_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(IMG_SSE2) && defined(__AVX2__)
+#define IMG_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace Engine
+{
+
+  // One prefix, prepared for testing many names against it. With SSE2 the first 16 bytes of the prefix
+  // (all of any camera prefix) are compared in one instruction, optionally ASCII case folded on the fly;
+  // elsewhere, and for the rest of longer prefixes, it is a plain loop. Nothing is read past the end of a name:
+  // names shorter than a vector are compared on half of one, or by the loop.
+  // The batch Match() is for names that sit in a buffer of the caller's with room behind them, like the getdents
+  // buffer of a directory scan: it loads 16 bytes per name without knowing its length, so there is no strlen and no
+  // short name case, and with AVX2 it does two names per instruction.
+  class PrefixMatcher
+  {
+  public:
+    PrefixMatcher(StringView prefix, bool fold);         // fold: 'a'..'z' equal 'A'..'Z', nothing else
+
+    bool Match(StringView name) const;
+    bool MatchScalar(StringView name) const;             // the same without SIMD, for comparison
+    // names: NUL terminated, each readable for 16 bytes from its start however short it is; matches[i] = 0/1;
+    // returns the number of matches
+    size_t Match(const Char* const* names, size_t count, uint8_t* matches) const;
+
+  private:
+    String m_prefix;                                     // folded if m_fold
+    bool m_fold;
+#ifdef IMG_SSE2
+    __m128i m_vector{};                                  // first 16 bytes of the prefix, zero padded
+    unsigned m_mask{};                                   // movemask bits that have to match
+#endif
+  };
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint64_t
+
+namespace Engine
+{
+
+  // Live counters of one run. The engine's threads bump them as they go; a UI timer or a status line reads them at
+  // any time, without locking and without slowing the run down. One Progress per run: it starts the clock when made.
+  struct Progress
+  {
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<size_t> directories{};                   // directories listed
+    std::atomic<size_t> matched{};                       // files planned for renaming
+    std::atomic<size_t> renamed{};
+    std::atomic<size_t> failed{};
+    std::atomic<uint64_t> bytes{};                       // read from files, for EXIF fields
+    const Clock::time_point started{ Clock::now() };
+
+    double Seconds() const { return std::chrono::duration<double>(Clock::now() - started).count(); }
+    double BytesPerSecond() const
+    {
+      double seconds = Seconds();
+      return seconds > 0 ? static_cast<double>(bytes.load(std::memory_order_relaxed)) / seconds : 0.0;
+    }
+  };
+
+  // Cooperative cancellation: whoever owns the run calls Cancel() from any thread, even a signal handler. The engine
+  // looks at it before every directory it lists or renames in, so a run stops within one directory's work and leaves
+  // no directory half done. A journaled run cancelled this way resumes where it stopped.
+  class CancelToken
+  {
+  public:
+    void Cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    bool Cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<bool> m_cancelled{};
+  };
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>          // For size_t
+#include <memory>           // For std::unique_ptr
+#include <thread>           // For std::this_thread
+
+namespace Engine
+{
+
+  // Bounded multi-producer multi-consumer queue without locks (Vyukov's ring: every cell carries a sequence number
+  // that tells producers and consumers whose turn it is). Push() waits while the queue is full, which is what keeps
+  // a fast stage from running away from a slow one; Pop() waits while it is empty, until Close().
+  template <typename T> class BoundedQueue
+  {
+  public:
+    explicit BoundedQueue(size_t capacity)
+    {
+      size_t n = 2;
+      while (n < capacity) n *= 2;
+      m_cells.reset(new Cell[n]);
+      for (size_t i = 0; i < n; ++i) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+      m_mask = n - 1;
+    }
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool TryPush(T value)
+    {
+      size_t pos = m_tail.load(std::memory_order_relaxed);
+      for (;;)
+      {
+        Cell& cell = m_cells[pos & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0)
+        {
+          if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            cell.value = std::move(value);
+            cell.sequence.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        }
+        else if (diff < 0) return false;                 // full
+        else pos = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+
+    bool TryPop(T& value)
+    {
+      size_t pos = m_head.load(std::memory_order_relaxed);
+      for (;;)
+      {
+        Cell& cell = m_cells[pos & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+        if (diff == 0)
+        {
+          if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            value = std::move(cell.value);
+            cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+            return true;
+          }
+        }
+        else if (diff < 0) return false;                 // empty
+        else pos = m_head.load(std::memory_order_relaxed);
+      }
+    }
+
+    void Push(T value)
+    {
+      for (unsigned spins = 0; !TryPush(value); ++spins) Back(spins);
+    }
+
+    bool Pop(T& value)                                   // false once the queue is closed and drained
+    {
+      for (unsigned spins = 0; !TryPop(value); ++spins)
+      {
+        if (m_closed.load(std::memory_order_acquire) && Size() == 0) return TryPop(value);
+        Back(spins);
+      }
+      return true;
+    }
+
+    void Close() { m_closed.store(true, std::memory_order_release); }   // no more Push() calls will come
+    size_t Size() const                                  // approximate while others push and pop
+    {
+      size_t tail = m_tail.load(std::memory_order_relaxed);
+      size_t head = m_head.load(std::memory_order_relaxed);
+      return tail > head ? tail - head : 0;
+    }
+    size_t Capacity() const { return m_mask + 1; }
+
+  private:
+    struct Cell
+    {
+      std::atomic<size_t> sequence;
+      T value;
+    };
+
+    static void Back(unsigned spins)                     // spin briefly, then yield, then sleep: waiting is for I/O, not for nanoseconds
+    {
+      if (spins < 64) return;
+      if (spins < 128) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+  private:
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask{};
+    alignas(64) std::atomic<size_t> m_head{};            // next cell to pop; own cache line, consumers hammer it
+    alignas(64) std::atomic<size_t> m_tail{};            // next cell to push
+    alignas(64) std::atomic<bool> m_closed{};
+  };
+
+}
@@ -0,0 +1,144 @@
+#include <algorithm>        // For std::lower_bound, std::all_of
+#include <map>
+
+#ifdef _WIN32
+#include <wctype.h>         // For towupper()
+#endif
+
+#include "Platform.h"
+#include "Rules.h"
+
+namespace Engine
+{
+
+  // the platform's case rule, as Platform::HasPrefix applies it
+  static inline Char Fold(Char c)
+  {
+#ifdef _WIN32
+    if (c >= L'a' && c <= L'z') return static_cast<Char>(c - L'a' + L'A');
+    if (c >= 0x80) return static_cast<Char>(::towupper(c));
+#endif
+    return c;
+  }
+
+  RuleSet::RuleSet(const std::vector<Rule>& rules)
+  {
+    // build with maps first, then flatten into sorted edge arrays that Match() can binary search
+    std::vector<std::map<Char, uint32_t>> edges(1);
+    std::vector<int32_t> ends(1, -1);
+    for (const Rule& rule : rules)
+    {
+      if (rule.from.empty()) continue;
+      uint32_t node = 0;
+      for (Char c : rule.from)
+      {
+        auto it = edges[node].find(Fold(c));
+        if (it == edges[node].end())
+        {
+          it = edges[node].emplace(Fold(c), static_cast<uint32_t>(edges.size())).first;
+          edges.emplace_back();
+          ends.push_back(-1);
+        }
+        node = it->second;
+      }
+      if (ends[node] != -1) continue;                    // same prefix as an earlier rule
+      ends[node] = static_cast<int32_t>(m_rules.size());
+      m_rules.push_back(rule);
+    }
+
+    // the usual single rule goes to the vector compare instead; it folds ASCII only, so on Windows it takes ASCII prefixes only
+#ifdef _WIN32
+    bool fold = true;
+#else
+    bool fold = false;
+#endif
+    auto ascii = [](const String& s) { return std::all_of(s.begin(), s.end(), [](Char c) { return static_cast<unsigned>(c) < 0x80; }); };
+    if (m_rules.size() == 1 && (!fold || ascii(m_rules[0].from))) m_single.emplace(m_rules[0].from, fold);
+
+    m_nodes.reserve(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i)
+    {
+      m_nodes.push_back(Node{ static_cast<uint32_t>(m_labels.size()), static_cast<uint32_t>(edges[i].size()), ends[i] });
+      for (const auto& e : edges[i])
+      {
+        m_labels.push_back(e.first);
+        m_children.push_back(e.second);
+      }
+    }
+  }
+
+  const Rule* RuleSet::Match(StringView name) const
+  {
+    if (m_rules.empty()) return nullptr;
+    if (m_single) return m_single->Match(name) ? &m_rules[0] : nullptr;
+    const Node* node = &m_nodes[0];
+    int32_t best = -1;
+    for (Char c : name)
+    {
+      const Char* begin = m_labels.data() + node->first;
+      const Char* end = begin + node->count;
+      const Char* it = std::lower_bound(begin, end, Fold(c));
+      if (it == end || *it != Fold(c)) break;
+      node = &m_nodes[m_children[static_cast<size_t>(it - m_labels.data())]];
+      if (node->rule != -1) best = node->rule;
+    }
+    return best == -1 ? nullptr : &m_rules[static_cast<size_t>(best)];
+  }
+
+  size_t RuleSet::Match(const Char* const* names, size_t count, uint8_t* matches) const
+  {
+    if (m_single) return m_single->Match(names, count, matches);
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i)                   // several rules: one trie walk per name
+    {
+      matches[i] = Match(StringView(names[i])) != nullptr ? 1 : 0;
+      n += matches[i];
+    }
+    return n;
+  }
+
+  String RuleSet::Key() const
+  {
+    String key{};
+    for (const Rule& rule : m_rules) key.append(rule.from).append(1, IMG_TEXT('\t')).append(rule.to).append(1, IMG_TEXT('\n'));
+    return key;
+  }
+
+  static bool IsSpace(Char c)
+  {
+    return c == IMG_TEXT(' ') || c == IMG_TEXT('\t') || c == IMG_TEXT('\r');
+  }
+
+  std::vector<Rule> LoadRules(const String& file)
+  {
+    String text = Platform::ReadText(file);
+    std::vector<Rule> rules{};
+    StringView rest{ text };
+    for (unsigned line = 1; !rest.empty(); ++line)
+    {
+      size_t eol = rest.find(IMG_TEXT('\n'));
+      StringView s = rest.substr(0, eol);
+      rest = eol == StringView::npos ? StringView{} : rest.substr(eol + 1);
+
+      while (!s.empty() && IsSpace(s.front())) s.remove_prefix(1);
+      while (!s.empty() && IsSpace(s.back())) s.remove_suffix(1);
+      if (s.empty() || s.front() == IMG_TEXT('#')) continue;
+
+      size_t gap = 0;                                    // "from to": the first word is the old prefix, the rest of the line the new one
+      while (gap < s.size() && !IsSpace(s[gap])) ++gap;
+      Rule rule{ String(s.substr(0, gap)), String{} };
+      s.remove_prefix(gap);
+      while (!s.empty() && IsSpace(s.front())) s.remove_prefix(1);
+      rule.to = String(s);
+
+      for (const Rule& r : rules)
+      {
+        if (r.from.size() == rule.from.size() && Platform::HasPrefix(r.from, rule.from))
+          throw Error("duplicate prefix in line " + std::to_string(line), file, 0);
+      }
+      rules.push_back(std::move(rule));
+    }
+    return rules;
+  }
+
+}
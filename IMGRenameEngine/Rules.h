@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint8_t, uint32_t
+#include <optional>
+#include <vector>
+
+#include "Common.h"
+#include "Prefix.h"
+
+namespace Engine
+{
+
+  // One prefix replacement: files named from... become to...
+  struct Rule
+  {
+    String from;
+    String to;
+  };
+
+  // A set of prefix rules compiled into a trie. Matching a name walks the trie once along the name,
+  // so the cost depends on the length of the matching prefix, not on the number of rules.
+  // Prefixes compare with the platform's case rule, like Platform::HasPrefix.
+  class RuleSet
+  {
+  public:
+    RuleSet() = default;
+    explicit RuleSet(const std::vector<Rule>& rules);   // empty prefixes are ignored; of two equal prefixes the first one counts
+
+    const Rule* Match(StringView name) const;            // the rule with the longest from that starts name, or nullptr
+    size_t Match(const Char* const* names, size_t count, uint8_t* matches) const;   // whether any rule matches, as PrefixMatcher's batch Match()
+    bool Empty() const { return m_rules.empty(); }
+    const std::vector<Rule>& Rules() const { return m_rules; }
+    String Key() const;                                  // all rules as text, to tell runs with different rules apart
+
+  private:
+    struct Node
+    {
+      uint32_t first;                                    // first edge in m_labels / m_children
+      uint32_t count;                                    // number of edges, sorted by label
+      int32_t rule;                                      // rule ending here, -1 if none
+    };
+
+  private:
+    std::vector<Rule> m_rules;
+    std::vector<Node> m_nodes;                           // m_nodes[0] is the root
+    std::vector<Char> m_labels;                          // edge labels, case folded where the platform ignores case
+    std::vector<uint32_t> m_children;                    // edge targets, parallel to m_labels
+    std::optional<PrefixMatcher> m_single;               // the usual case of one rule, matched with SIMD instead of the trie
+  };
+
+  std::vector<Rule> LoadRules(const String& file);       // one "from to" pair per line, # starts a comment; throws Error
+
+}
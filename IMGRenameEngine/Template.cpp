@@ -0,0 +1,118 @@
+#include "Exif.h"
+#include "Template.h"
+
+namespace Engine
+{
+
+  NameTemplate::NameTemplate(StringView text) : m_text(text)
+  {
+    static const struct { StringView name; Field field; } fields[]{
+      { IMG_TEXT("{DateTimeOriginal}"), Field::DateTimeOriginal },
+      { IMG_TEXT("{SubSecTime}"), Field::SubSecTime },
+      { IMG_TEXT("{Model}"), Field::Model },
+      { IMG_TEXT("{Year}"), Field::Year },
+      { IMG_TEXT("{Month}"), Field::Month },
+      { IMG_TEXT("{Day}"), Field::Day },
+    };
+
+    size_t literal = 0;                                  // start of the pending literal text
+    for (size_t i = 0; i < m_text.size(); ++i)
+    {
+      if (m_text[i] != IMG_TEXT('{')) continue;
+      for (const auto& f : fields)
+      {
+        if (StringView(m_text).substr(i, f.name.size()) != f.name) continue;
+        if (i > literal) m_parts.push_back(Part{ Field::Text, literal, i - literal });
+        m_parts.push_back(Part{ f.field, 0, 0 });
+        m_plain = false;
+        i += f.name.size() - 1;
+        literal = i + 1;
+        break;
+      }
+    }
+    if (m_text.size() > literal) m_parts.push_back(Part{ Field::Text, literal, m_text.size() - literal });
+  }
+
+  static bool IsDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  // s starts with shape, where '9' stands for any digit; stops at s's NUL
+  static bool Shaped(const char* s, const char* shape)
+  {
+    for (; *shape != 0; ++s, ++shape)
+    {
+      if (*shape == '9' ? !IsDigit(*s) : *s != *shape) return false;
+    }
+    return true;
+  }
+
+  // a usable capture date: "YYYY:MM:DD", with the time " HH:MM:SS" too if time is set; unset clocks write blanks or
+  // zeros, and a damaged or cut off field must not end up in a name
+  static bool Dated(const char* s, bool time)
+  {
+    return Shaped(s, time ? "9999:99:99 99:99:99" : "9999:99:99") && !(s[0] == '0' && s[1] == '0' && s[2] == '0' && s[3] == '0');
+  }
+
+  size_t NameTemplate::Expand(const Exif& exif, Char* out, size_t capacity) const
+  {
+    size_t n = 0;
+    auto put = [&](Char c)
+      {
+        if (n < capacity) out[n] = c;
+        ++n;
+      };
+
+    for (const Part& part : m_parts)
+    {
+      switch (part.field)
+      {
+      case Field::Text:
+        for (size_t i = 0; i < part.length; ++i) put(m_text[part.begin + i]);
+        break;
+
+      case Field::DateTimeOriginal:
+      {
+        const char* s = exif.dateTimeOriginal;
+        if (!Dated(s, true)) return static_cast<size_t>(-1);
+        for (size_t i = 0; s[i] != 0; ++i)
+        {
+          if (s[i] == ' ') put(IMG_TEXT('_'));
+          else if (IsDigit(s[i])) put(static_cast<Char>(s[i]));
+        }
+        break;
+      }
+
+      case Field::Year:
+      case Field::Month:
+      case Field::Day:
+      {
+        const char* s = exif.dateTimeOriginal;
+        if (!Dated(s, false)) return static_cast<size_t>(-1);
+        size_t begin = part.field == Field::Year ? 0 : part.field == Field::Month ? 5 : 8;
+        size_t end = part.field == Field::Year ? 4 : begin + 2;
+        for (size_t i = begin; i < end; ++i) put(static_cast<Char>(s[i]));
+        break;
+      }
+
+      case Field::SubSecTime:
+        if (!IsDigit(exif.subSecTime[0])) return static_cast<size_t>(-1);
+        for (const char* s = exif.subSecTime; IsDigit(*s); ++s) put(static_cast<Char>(*s));
+        break;
+
+      case Field::Model:
+        if (exif.model[0] == 0) return static_cast<size_t>(-1);
+        for (const char* s = exif.model; *s != 0; ++s)
+        {
+          char c = *s;
+          bool bad = c == ' ' || c == '/' || c == '\\' || c == ':' || c == '*' || c == '?' || c == '"' || c == '<' || c == '>' || c == '|';
+          put(bad || static_cast<unsigned char>(c) < 0x20 ? IMG_TEXT('-') : static_cast<Char>(static_cast<unsigned char>(c)));
+        }
+        break;
+      }
+    }
+    return n <= capacity ? n : static_cast<size_t>(-1);
+  }
+
+}
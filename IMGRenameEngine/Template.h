@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint8_t
+#include <vector>
+
+#include "Common.h"
+
+namespace Engine
+{
+
+  struct Exif;
+
+  // A new prefix that may contain EXIF fields in braces, e.g. "{Model}_{DateTimeOriginal}_":
+  //   {DateTimeOriginal}  capture time as YYYYMMDD_HHMMSS
+  //   {SubSecTime}        fraction of the second, for bursts
+  //   {Model}             camera model, blanks and characters not allowed in file names replaced by '-'
+  //   {Year} {Month} {Day} parts of the capture date, YYYY, MM and DD; for folder templates like "{Year}/{Month}/{Day}"
+  // Anything else, unknown fields included, is copied as it is. Parsed once per run, expanded per file without allocating.
+  class NameTemplate
+  {
+  public:
+    explicit NameTemplate(StringView text);
+
+    bool Plain() const { return m_plain; }               // no fields: the file doesn't have to be read
+    size_t Expand(const Exif& exif, Char* out, size_t capacity) const;   // characters written, or npos if a field is missing or out is too small
+
+  private:
+    enum class Field : uint8_t { Text, DateTimeOriginal, SubSecTime, Model, Year, Month, Day };
+    struct Part
+    {
+      Field field;
+      size_t begin;                                      // literal text in m_text (Field::Text only)
+      size_t length;
+    };
+
+  private:
+    String m_text;
+    std::vector<Part> m_parts;
+    bool m_plain{ true };
+  };
+
+}
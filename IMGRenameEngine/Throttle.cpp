@@ -0,0 +1,92 @@
+#include <algorithm>        // For std::max, std::min
+#include <thread>           // For std::this_thread
+
+#include "Throttle.h"
+
+namespace Engine
+{
+
+  static constexpr double Tolerance = 2.0;               // a round this many times slower than the baseline means queueing
+  static constexpr double Backoff = 0.75;                // multiplicative decrease
+  static constexpr double Growth = 1.0 / 8;              // additive increase per round, as a share of the limit (at least one)
+  static constexpr double Drift = 1.15;                  // the baseline forgets this much per round, faster than the limit grows
+  static constexpr unsigned InitialLimit = 4;
+
+  RateLimit::RateLimit(double perSecond) :
+    m_interval(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / std::max(perSecond, 0.001))))
+  {
+  }
+
+  void RateLimit::Wait()
+  {
+    Clock::time_point start{};
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      start = std::max(m_next, Clock::now());            // no credit for idle time: that would allow bursts
+      m_next = start + m_interval;
+    }
+    std::this_thread::sleep_until(start);
+  }
+
+  Throttle::Throttle(unsigned maximum, bool adaptive, RateLimit* rate) :
+    m_rate(rate), m_maximum(std::max(maximum, 1u)), m_adaptive(adaptive),
+    m_limit(adaptive ? std::min(InitialLimit, std::max(maximum, 1u)) : std::max(maximum, 1u))
+  {
+  }
+
+  void Throttle::Acquire()
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_room.wait(lock, [this] { return m_inFlight < static_cast<unsigned>(m_limit); });
+      ++m_inFlight;
+    }
+    if (m_rate != nullptr) m_rate->Wait();
+  }
+
+  bool Throttle::TryAcquire()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      if (m_inFlight >= static_cast<unsigned>(m_limit)) return false;
+      ++m_inFlight;
+    }
+    if (m_rate != nullptr) m_rate->Wait();
+    return true;
+  }
+
+  void Throttle::Release(Clock::duration latency)
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      --m_inFlight;
+      if (m_adaptive) Adapt(std::chrono::duration<double>(latency).count());
+    }
+    m_room.notify_all();                                 // the limit may have grown by more than the one place freed
+  }
+
+  unsigned Throttle::Limit()
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return static_cast<unsigned>(m_limit);
+  }
+
+  void Throttle::Adapt(double latency)
+  {
+    // decide once per round of completions, on their mean: single samples are too noisy, and in a batch (io_uring)
+    // the first completion is always much faster than the last
+    m_sum += latency;
+    if (++m_count < static_cast<unsigned>(m_limit)) return;
+    double mean = m_sum / m_count;
+    m_sum = 0;
+    m_count = 0;
+
+    // the baseline is a decaying minimum of the round means. It follows latency that grows with the limit, as it does
+    // on a local disk where a bigger batch takes longer to come back, and is left behind when latency jumps, as it
+    // does when a filer runs out of room and starts queueing behind other clients
+    m_best = m_best == 0 ? mean : std::min(mean, m_best * Drift);
+    if (mean > m_best * Tolerance) m_limit = std::max(m_limit * Backoff, 1.0);
+    else m_limit = std::min(m_limit + std::max(m_limit * Growth, 1.0), static_cast<double>(m_maximum));
+  }
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace Engine
+{
+
+  // Hard cap on operations per second, shared by everything that calls Wait(): the ops are spaced evenly,
+  // without bursts, so a nightly run can't flood a filer that others are using.
+  class RateLimit
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RateLimit(double perSecond);
+    void Wait();                                         // returns when the caller's op may start; thread safe
+
+  private:
+    std::mutex m_lock;
+    Clock::duration m_interval;
+    Clock::time_point m_next{};                          // earliest start of the next op
+  };
+
+  // Limit on the operations of one kind in flight at the same time, optionally adapted to their latency (AIMD):
+  // while a round of completions comes back about as fast as the recent rounds did, the limit grows by an eighth
+  // per round; when the mean latency of a round jumps well above the recent ones, the link or the filer is
+  // queueing, and the limit shrinks by a quarter. On a local disk the limit ends up at the maximum; on a slow
+  // share it hovers below the point where latency jumps.
+  class Throttle
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // holds a place in flight for its lifetime and reports the time it took; a null throttle makes it a no-op
+    class Slot
+    {
+    public:
+      explicit Slot(Throttle* throttle) : m_throttle(throttle)
+      {
+        if (m_throttle == nullptr) return;
+        m_throttle->Acquire();
+        m_start = Clock::now();
+      }
+      ~Slot()
+      {
+        if (m_throttle != nullptr) m_throttle->Release(Clock::now() - m_start);
+      }
+      Slot(const Slot&) = delete;
+      Slot& operator=(const Slot&) = delete;
+
+    private:
+      Throttle* m_throttle;
+      Clock::time_point m_start{};
+    };
+
+    Throttle(unsigned maximum, bool adaptive, RateLimit* rate);   // rate: shared cap, or nullptr
+
+    void Acquire();                                      // wait for a place in flight, then for the rate limit
+    bool TryAcquire();                                   // the same without waiting for a place; false if there is none
+    void Release(Clock::duration latency);               // the op is done and took latency
+    unsigned Limit();                                    // ops allowed in flight right now
+
+  private:
+    void Adapt(double latency);
+
+  private:
+    std::mutex m_lock;                                   // guards everything below
+    std::condition_variable m_room;
+    RateLimit* m_rate;
+    const unsigned m_maximum;
+    const bool m_adaptive;
+    double m_limit;                                      // fractional, so repeated decreases don't round down to nothing
+    unsigned m_inFlight{};
+    double m_best{};                                     // baseline: decaying minimum of the round means, seconds
+    double m_sum{};                                      // latencies of the current round, seconds
+    unsigned m_count{};                                  // completions in the current round
+  };
+
+}
@@ -0,0 +1,170 @@
+#include <algorithm>        // For std::sort, std::max
+#include <chrono>
+#include <cstdio>           // For snprintf()
+#include <cstring>          // For memcpy()
+#include <map>
+#include <memory>           // For std::unique_ptr
+#include <mutex>
+#include <vector>
+
+#include "Platform.h"
+#include "Trace.h"
+
+namespace Engine
+{
+
+  std::atomic<bool> Tracer::s_on{};
+
+  struct TraceEvent
+  {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+  };
+
+  // one per thread that recorded something; only its own thread writes to it
+  struct TraceRing
+  {
+    std::vector<TraceEvent> events;
+    uint64_t next{};                                     // events recorded so far; the newest is at (next - 1) % size
+    unsigned thread{};                                   // small number for the trace viewer
+  };
+
+  struct TraceState
+  {
+    std::mutex lock;                                     // guards rings, taken once per thread and Start()
+    std::vector<std::unique_ptr<TraceRing>> rings;
+    size_t capacity{};
+    std::atomic<unsigned> generation{};                  // bumped by Start(): rings of earlier generations are gone
+    std::atomic<int64_t> epoch{};                        // steady clock at Start(), in its own ticks
+  };
+
+  static TraceState state{};
+  static thread_local TraceRing* ring{};
+  static thread_local unsigned ringGeneration{};
+
+  static TraceRing* ThreadRing()
+  {
+    unsigned generation = state.generation.load(std::memory_order_acquire);
+    if (ring != nullptr && ringGeneration == generation) return ring;
+    std::lock_guard<std::mutex> guard(state.lock);
+    auto r = std::make_unique<TraceRing>();
+    r->events.resize(state.capacity);
+    r->thread = static_cast<unsigned>(state.rings.size() + 1);
+    ring = r.get();
+    ringGeneration = generation;
+    state.rings.push_back(std::move(r));
+    return ring;
+  }
+
+  void Tracer::Start(size_t events)
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    state.rings.clear();
+    state.capacity = std::max<size_t>(events, 16);
+    state.epoch.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    state.generation.fetch_add(1, std::memory_order_release);
+    s_on.store(true, std::memory_order_release);
+  }
+
+  void Tracer::Stop()
+  {
+    s_on.store(false, std::memory_order_release);
+  }
+
+  uint64_t Tracer::Now()
+  {
+    std::chrono::steady_clock::duration since(std::chrono::steady_clock::now().time_since_epoch().count() - state.epoch.load(std::memory_order_relaxed));
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since).count());
+  }
+
+  void Tracer::Record(const char* name, uint64_t begin, uint64_t end)
+  {
+    TraceRing* r = ThreadRing();
+    r->events[static_cast<size_t>(r->next % r->events.size())] = TraceEvent{ name, begin, end };
+    ++r->next;
+  }
+
+  // calls f(thread, event) for every event still in the rings, oldest first per thread
+  template <typename F> static void ForEachEvent(F f)
+  {
+    for (const auto& r : state.rings)
+    {
+      uint64_t size = r->events.size();
+      uint64_t first = r->next > size ? r->next - size : 0;
+      for (uint64_t i = first; i < r->next; ++i) f(r->thread, r->events[static_cast<size_t>(i % size)]);
+    }
+  }
+
+  void Tracer::Write(const String& file)
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    char line[256];
+    for (const auto& r : state.rings)
+    {
+      snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}},\n", r->thread, r->thread);
+      json += line;
+    }
+    ForEachEvent([&](unsigned thread, const TraceEvent& e)
+      {
+        snprintf(line, sizeof(line), "{\"name\":\"%s\",\"cat\":\"imgrename\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+          e.name, thread, static_cast<double>(e.begin) / 1000, static_cast<double>(e.end - e.begin) / 1000);
+        json += line;
+      });
+    if (json.size() >= 2 && json.compare(json.size() - 2, 2, ",\n") == 0) json.resize(json.size() - 2);   // no comma after the last event
+    json += "\n]}\n";
+
+    MappedFile f{};
+    f.Open(file, true);
+    f.Resize(json.size());
+    memcpy(f.Data(), json.data(), json.size());
+    f.Close();
+  }
+
+  std::string Tracer::Summary()
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    std::map<std::string, std::vector<uint64_t>> spans{};   // name -> durations in ns
+    uint64_t dropped = 0;
+    for (const auto& r : state.rings) dropped += r->next > r->events.size() ? r->next - r->events.size() : 0;
+    ForEachEvent([&spans](unsigned, const TraceEvent& e) { spans[e.name].push_back(e.end - e.begin); });
+
+    std::string out = "span            count   total ms     p50 us     p99 us     max us\n";
+    char line[256];
+    for (auto& span : spans)
+    {
+      std::vector<uint64_t>& d = span.second;
+      std::sort(d.begin(), d.end());
+      uint64_t total = 0;
+      size_t buckets[40]{};                              // [i]: durations in [2^i, 2^(i+1)) microseconds; [0]: under 2 us
+      for (uint64_t ns : d)
+      {
+        total += ns;
+        size_t b = 0;
+        for (uint64_t us = ns / 1000; us > 1 && b < 39; us >>= 1) ++b;
+        ++buckets[b];
+      }
+      auto us = [&d](double p) { return static_cast<double>(d[static_cast<size_t>(p * static_cast<double>(d.size() - 1) + 0.5)]) / 1000; };
+      snprintf(line, sizeof(line), "%-12s %8zu %10.3f %10.2f %10.2f %10.2f\n", span.first.c_str(), d.size(), static_cast<double>(total) / 1e6,
+        us(0.5), us(0.99), static_cast<double>(d.back()) / 1000);
+      out += line;
+      out += "  histogram:";
+      for (size_t b = 0; b < 40; ++b)
+      {
+        if (buckets[b] == 0) continue;
+        if (b == 0) snprintf(line, sizeof(line), " <2us:%zu", buckets[b]);
+        else snprintf(line, sizeof(line), " %lluus:%zu", 1ull << b, buckets[b]);
+        out += line;
+      }
+      out += '\n';
+    }
+    if (dropped > 0)
+    {
+      snprintf(line, sizeof(line), "%llu older events were overwritten, start with a larger ring to keep them\n", static_cast<unsigned long long>(dropped));
+      out += line;
+    }
+    return out;
+  }
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint64_t
+#include <string>
+
+#include "Common.h"
+
+namespace Engine
+{
+
+  // Optional instrumentation of the hot path. Span objects around listing, matching, planning and renaming record
+  // their begin and end into a ring buffer of the calling thread, without locks; Tracer writes the rings out as Chrome
+  // trace events (chrome://tracing, Perfetto) and sums them up per span name. While tracing is off, a Span costs one
+  // relaxed load and a branch, and records nothing.
+  class Tracer
+  {
+  public:
+    static void Start(size_t events = 64 * 1024);        // turn tracing on, dropping earlier events; events: ring size per thread, the oldest get overwritten
+    static void Stop();                                  // turn it off; the events stay for Write() and Summary()
+    static bool On() { return s_on.load(std::memory_order_relaxed); }
+
+    // call these between runs only: they read the rings of all threads
+    static void Write(const String& file);               // Chrome trace event JSON; throws Error
+    static std::string Summary();                        // per span name: count, total, p50, p99, max and a log2 histogram of durations
+
+    static uint64_t Now();                               // nanoseconds since Start()
+    static void Record(const char* name, uint64_t begin, uint64_t end);   // name must be a string literal
+
+  private:
+    static std::atomic<bool> s_on;
+  };
+
+  // Records the time from its construction to its destruction under name, if tracing is on
+  class Span
+  {
+  public:
+    explicit Span(const char* name)
+    {
+      if (!Tracer::On()) return;
+      m_name = name;
+      m_begin = Tracer::Now();
+    }
+    ~Span()
+    {
+      if (m_name != nullptr) Tracer::Record(m_name, m_begin, Tracer::Now());
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+  private:
+    const char* m_name{};
+    uint64_t m_begin{};
+  };
+
+}
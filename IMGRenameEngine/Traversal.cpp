@@ -0,0 +1,37 @@
+#include "Traversal.h"
+
+namespace Engine
+{
+
+  bool Traversal::Enter(const Signature& directory)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_visited.empty()) m_device = directory.device;
+    else if (m_oneFileSystem && directory.device != m_device) return false;   // a mount point: neither walked nor counted
+    if (m_visited.insert(Key{ directory.device, directory.inode }).second) return true;
+    ++m_revisits;
+    return false;
+  }
+
+  void Traversal::Push(const String& parent, const String& name)
+  {
+    m_starts.push_back(m_paths.size());
+    m_paths.append(parent).append(1, Separator).append(name);
+  }
+
+  void Traversal::Push(const String& path)
+  {
+    m_starts.push_back(m_paths.size());
+    m_paths.append(path);
+  }
+
+  bool Traversal::Pop(String& path)
+  {
+    if (m_starts.empty()) return false;
+    path.assign(m_paths, m_starts.back(), String::npos);
+    m_paths.resize(m_starts.back());
+    m_starts.pop_back();
+    return true;
+  }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint64_t
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "Platform.h"
+
+namespace Engine
+{
+
+  // The state of one walk through a tree, in place of the native stack. Directories are identified by (device, inode)
+  // - volume serial number and file index on Windows - and each one is entered once: a symlinked directory, a junction
+  // or a bind mount leading back up the tree, or into a part already walked, is not walked again. The set is shared
+  // by all threads. A single-threaded walk keeps the directories still to be listed on an explicit stack, their paths
+  // back to back in one string, so the depth of a tree costs neither native stack nor an allocation per directory.
+  class Traversal
+  {
+  public:
+    explicit Traversal(bool oneFileSystem) : m_oneFileSystem(oneFileSystem) {}
+
+    bool Enter(const Signature& directory);              // false if it was entered before, or is on another file system than the first one; thread safe
+    void Push(const String& parent, const String& name); // parent/name is still to be listed
+    void Push(const String& path);
+    bool Pop(String& path);                              // the directory pushed last; false if there are none left
+    size_t Revisits() const { return m_revisits; }       // directories found a second time and left alone
+
+  private:
+    struct Key
+    {
+      uint64_t device;
+      uint64_t inode;
+
+      bool operator==(const Key& o) const { return device == o.device && inode == o.inode; }
+    };
+
+    struct KeyHash
+    {
+      size_t operator()(const Key& k) const { return static_cast<size_t>(k.inode * 0x9E3779B97F4A7C15ull ^ k.device); }
+    };
+
+  private:
+    bool m_oneFileSystem;
+    std::mutex m_lock;                                   // guards everything up to m_revisits
+    std::unordered_set<Key, KeyHash> m_visited;
+    uint64_t m_device{};                                 // of the first directory entered
+    size_t m_revisits{};
+    String m_paths;                                      // the stack: pending paths back to back, single-threaded walks only
+    std::vector<size_t> m_starts;                        // where each one starts in m_paths
+  };
+
+}
@@ -0,0 +1,176 @@
+#include "Uring.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>          // For AT_FDCWD
+#include <stdio.h>          // For RENAME_NOREPLACE, renameat2()
+#include <linux/io_uring.h>
+#include <string.h>         // For memset()
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Engine
+{
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+  static inline unsigned Load(const unsigned* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+  static inline void Store(unsigned* p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+  static bool Supports(int fd, int op)
+  {
+    size_t size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    std::unique_ptr<char[]> buffer = std::make_unique<char[]>(size);
+    memset(buffer.get(), 0, size);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.get());
+    if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) return false;
+    return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+  }
+
+  std::unique_ptr<Uring> Uring::Create(unsigned depth)
+  {
+    io_uring_params p{};
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &p));
+    if (fd < 0) return nullptr;                          // kernel too old, or io_uring disabled
+
+    std::unique_ptr<Uring> u(new Uring());
+    u->m_fd = fd;
+    u->m_depth = p.sq_entries;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !Supports(fd, IORING_OP_RENAMEAT)) return nullptr;
+
+    size_t sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    u->m_ringSize = sqSize > cqSize ? sqSize : cqSize;
+    u->m_ring = ::mmap(nullptr, u->m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (u->m_ring == MAP_FAILED) { u->m_ring = nullptr; return nullptr; }
+    u->m_sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+    u->m_sqes = ::mmap(nullptr, u->m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (u->m_sqes == MAP_FAILED) { u->m_sqes = nullptr; return nullptr; }
+
+    char* ring = static_cast<char*>(u->m_ring);
+    u->m_sqHead = reinterpret_cast<unsigned*>(ring + p.sq_off.head);
+    u->m_sqTail = reinterpret_cast<unsigned*>(ring + p.sq_off.tail);
+    u->m_sqMask = reinterpret_cast<unsigned*>(ring + p.sq_off.ring_mask);
+    u->m_sqArray = reinterpret_cast<unsigned*>(ring + p.sq_off.array);
+    u->m_cqHead = reinterpret_cast<unsigned*>(ring + p.cq_off.head);
+    u->m_cqTail = reinterpret_cast<unsigned*>(ring + p.cq_off.tail);
+    u->m_cqMask = reinterpret_cast<unsigned*>(ring + p.cq_off.ring_mask);
+    u->m_cqes = ring + p.cq_off.cqes;
+    return u;
+  }
+
+  Uring::~Uring()
+  {
+    if (m_sqes != nullptr) ::munmap(m_sqes, m_sqesSize);
+    if (m_ring != nullptr) ::munmap(m_ring, m_ringSize);
+    if (m_fd >= 0) ::close(m_fd);
+  }
+
+  void Uring::Enter(unsigned wait, const Completion& done)
+  {
+    for (;;)
+    {
+      long n = ::syscall(__NR_io_uring_enter, m_fd, m_queued, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+      if (n >= 0)
+      {
+        m_queued -= static_cast<unsigned>(n);            // the kernel may take fewer than offered; the rest stay in the ring for next time
+        return;
+      }
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EBUSY) return;     // out of resources or completions pile up: the caller reaps and comes back
+      Fallback(done);                                    // the ring is of no use any more; nothing queued may get lost
+      return;
+    }
+  }
+
+  void Uring::Fallback(const Completion& done)
+  {
+    unsigned tail = *m_sqTail;
+    unsigned head = tail - m_queued;                     // the entries written since the kernel last took any
+    for (; head != tail; ++head)
+    {
+      const io_uring_sqe* sqe = static_cast<const io_uring_sqe*>(m_sqes) + m_sqArray[head & *m_sqMask];
+      int result = ::renameat2(sqe->fd, reinterpret_cast<const char*>(sqe->addr), static_cast<int>(sqe->len),
+        reinterpret_cast<const char*>(sqe->addr2), sqe->rename_flags) == 0 ? 0 : -errno;
+      --m_inflight;
+      done(sqe->user_data, result);
+    }
+    Store(m_sqTail, tail - m_queued);                    // take them back out of the ring
+    m_queued = 0;
+  }
+
+  static_assert(Uring::CurrentDirectory == AT_FDCWD && Uring::NoReplace == RENAME_NOREPLACE, "constants out of sync with the kernel headers");
+
+  void Uring::Rename(int fromDir, const Char* from, int toDir, const Char* to, unsigned flags, uint64_t cookie, const Completion& done)
+  {
+    while (m_inflight >= m_depth)                        // ring full: hand over what is queued and wait for one to finish
+    {
+      Enter(1, done);
+      Reap(done);
+    }
+
+    unsigned tail = *m_sqTail;                           // only we write the tail
+    unsigned index = tail & *m_sqMask;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_RENAMEAT;
+    sqe->fd = fromDir;
+    sqe->addr = reinterpret_cast<uint64_t>(from);
+    sqe->len = static_cast<uint32_t>(toDir);
+    sqe->addr2 = reinterpret_cast<uint64_t>(to);
+    sqe->rename_flags = flags;
+    sqe->user_data = cookie;
+    m_sqArray[index] = index;
+    Store(m_sqTail, tail + 1);
+    ++m_queued;
+    ++m_inflight;
+
+    if (m_queued >= m_depth / 2) Enter(0, done);         // keep the kernel busy while we fill the other half
+  }
+
+  size_t Uring::Reap(const Completion& done)
+  {
+    size_t n = 0;
+    unsigned head = *m_cqHead;
+    while (head != Load(m_cqTail))
+    {
+      const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(m_cqes) + (head & *m_cqMask);
+      uint64_t cookie = cqe->user_data;
+      int result = cqe->res;
+      ++head;
+      Store(m_cqHead, head);
+      --m_inflight;
+      ++n;
+      done(cookie, result);
+    }
+    return n;
+  }
+
+  void Uring::Drain(const Completion& done)
+  {
+    while (m_inflight > 0)
+    {
+      Enter(1, done);
+      Reap(done);
+    }
+  }
+
+#else
+
+  std::unique_ptr<Uring> Uring::Create(unsigned)
+  {
+    return nullptr;
+  }
+
+  Uring::~Uring() = default;
+  void Uring::Enter(unsigned, const Completion&) {}
+  void Uring::Fallback(const Completion&) {}
+  void Uring::Rename(int, const Char*, int, const Char*, unsigned, uint64_t, const Completion&) {}
+  size_t Uring::Reap(const Completion&) { return 0; }
+  void Uring::Drain(const Completion&) {}
+
+#endif // __linux__
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint64_t
+#include <functional>       // For std::function
+#include <memory>           // For std::unique_ptr
+
+#include "Common.h"
+
+namespace Engine
+{
+
+  // Minimal io_uring for batched renameat submissions, straight on the system calls (no liburing needed).
+  // Create() returns nullptr where io_uring or IORING_OP_RENAMEAT is not available; callers then rename synchronously.
+  class Uring
+  {
+  public:
+    using Completion = std::function<void(uint64_t cookie, int result)>;   // result: 0 or -errno
+
+    static constexpr int CurrentDirectory{ -100 };       // AT_FDCWD
+    static constexpr unsigned NoReplace{ 1 };            // RENAME_NOREPLACE
+
+    static std::unique_ptr<Uring> Create(unsigned depth);
+    ~Uring();
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    // queue a renameat; both strings must stay valid until the completion. Submits and waits for room on its own when full.
+    void Rename(int fromDir, const Char* from, int toDir, const Char* to, unsigned flags, uint64_t cookie, const Completion& done);
+    void Drain(const Completion& done);                  // submit everything queued and wait for all completions
+    size_t InFlight() const { return m_inflight; }
+
+  private:
+    Uring() = default;
+    size_t Reap(const Completion& done);                 // handle the completions that are there, without waiting
+    void Enter(unsigned wait, const Completion& done);   // hand over what is queued, wait for that many completions
+    void Fallback(const Completion& done);               // rename what the kernel didn't take synchronously, as completions
+
+  private:
+    int m_fd{ -1 };
+    unsigned m_depth{};
+    unsigned m_queued{};                                 // written into the SQ ring, not yet handed to the kernel
+    size_t m_inflight{};                                 // handed to the kernel (or queued), not yet completed
+
+    void* m_ring{};                                      // SQ and CQ ring, one mapping
+    size_t m_ringSize{};
+    void* m_sqes{};
+    size_t m_sqesSize{};
+
+    unsigned* m_sqHead{};
+    unsigned* m_sqTail{};
+    unsigned* m_sqMask{};
+    unsigned* m_sqArray{};
+    unsigned* m_cqHead{};
+    unsigned* m_cqTail{};
+    unsigned* m_cqMask{};
+    void* m_cqes{};
+  };
+
+}
@@ -0,0 +1,162 @@
+#include "Watcher.h"
+#include "Platform.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <string.h>         // For strerror()
+#include <sys/inotify.h>
+#include <unistd.h>         // For read(), close()
+
+#include <chrono>
+#endif
+
+namespace Engine
+{
+
+  Watcher::Watcher(const Options& options, unsigned latency) : m_options(options), m_latency(latency), m_renamer(options)
+  {
+    while (m_options.path.size() > 1 && (m_options.path.back() == IMG_TEXT('/') || m_options.path.back() == IMG_TEXT('\\')))
+      m_options.path.pop_back();
+    // renamed files still match a rule if their new prefix starts with an old one; their events must not start another rename
+    std::vector<Rule> echoes{};
+    for (const Rule& rule : m_renamer.Rules().Rules())
+    {
+      if (m_renamer.Rules().Match(rule.to) != nullptr) echoes.push_back(Rule{ rule.to, String{} });
+    }
+    m_echoes = RuleSet(echoes);
+  }
+
+#ifdef __linux__
+
+  static constexpr uint32_t FileEvents = IN_CLOSE_WRITE | IN_MOVED_TO;   // a file is complete: written and closed, or moved in
+  static constexpr uint32_t DirEvents = IN_CREATE | IN_MOVED_TO;         // a subdirectory appeared (checked with IN_ISDIR)
+
+  void Watcher::Watch(const String& path, Arrivals* found)
+  {
+    uint32_t mask = FileEvents | (m_options.subdir ? DirEvents : 0u) | IN_ONLYDIR | IN_DONT_FOLLOW;
+    int wd = ::inotify_add_watch(m_fd, path.c_str(), mask);
+    if (wd < 0) throw Error(std::string("inotify_add_watch: ") + strerror(errno), path, errno);
+    m_watches[wd] = path;
+    if (!m_options.subdir) return;
+
+    Listing listing{};
+    Platform::Scan(path, m_renamer.Rules(), true, listing);
+    if (found != nullptr)
+    {
+      for (StringView name : listing.files)
+      {
+        if (m_echoes.Match(name) == nullptr) (*found)[path].emplace_back(name);
+      }
+    }
+    for (const String& name : listing.subdirs) Watch(path + Separator + name, found);
+  }
+
+  void Watcher::Rescan(const Report& report)
+  {
+    report(m_renamer.Run());
+  }
+
+  void Watcher::Run(const std::atomic<bool>& stop, const Report& report)
+  {
+    m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) throw Error(std::string("inotify_init1: ") + strerror(errno), m_options.path, errno);
+    struct Closer { int fd; ~Closer() { ::close(fd); } } closer{ m_fd };
+
+    Watch(m_options.path);                               // watch first, so nothing landing during the first run is missed
+    Rescan(report);
+
+    using Clock = std::chrono::steady_clock;
+    Arrivals pending{};
+    Clock::time_point deadline{};
+    alignas(inotify_event) char buffer[64 * 1024];
+    bool overflow = false;
+
+    while (!stop)
+    {
+      int timeout = 200;                                 // wake up regularly to look at stop
+      if (!pending.empty())
+      {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        timeout = left < 0 ? 0 : static_cast<int>(left);
+      }
+      pollfd p{ m_fd, POLLIN, 0 };
+      if (::poll(&p, 1, timeout) > 0)
+      {
+        for (;;)
+        {
+          ssize_t n = ::read(m_fd, buffer, sizeof(buffer));
+          if (n <= 0) break;
+          for (char* q = buffer; q < buffer + n;)
+          {
+            const inotify_event* e = reinterpret_cast<const inotify_event*>(q);
+            q += sizeof(inotify_event) + e->len;
+
+            if (e->mask & IN_Q_OVERFLOW) { overflow = true; continue; }
+            if (e->mask & IN_IGNORED) { m_watches.erase(e->wd); continue; }
+            auto it = m_watches.find(e->wd);
+            if (it == m_watches.end() || e->len == 0) continue;
+
+            if (e->mask & IN_ISDIR)
+            {
+              if (!m_options.subdir) continue;           // moved in (IN_MOVED_TO is a file event too), but below the root
+              // new subtree: watch it, and rename what is in it already with the next batch. Not a Run() of its own:
+              // the journal and the index belong to the run over the whole tree
+              bool idle = pending.empty();
+              try
+              {
+                Watch(it->second + Separator + e->name, &pending);
+              }
+              catch (const Error&)
+              {
+                // gone again; what was found before it went still counts
+              }
+              if (idle && !pending.empty()) deadline = Clock::now() + std::chrono::milliseconds(m_latency);
+              continue;
+            }
+            if (!(e->mask & FileEvents) || m_renamer.Rules().Match(e->name) == nullptr) continue;
+            if (m_echoes.Match(e->name) != nullptr) continue;   // the echo of one of our own renames
+            if (pending.empty()) deadline = Clock::now() + std::chrono::milliseconds(m_latency);
+            pending[it->second].emplace_back(e->name);
+          }
+        }
+      }
+
+      if (overflow)
+      {
+        overflow = false;
+        pending.clear();
+        Watch(m_options.path);                           // directories created meanwhile have no watch yet
+        Rescan(report);
+        continue;
+      }
+      if (pending.empty() || Clock::now() < deadline) continue;
+
+      for (auto& d : pending)
+      {
+        Result result = m_renamer.RenameFiles(d.first, d.second);
+        report(result);
+      }
+      pending.clear();
+    }
+  }
+
+#else
+
+  void Watcher::Watch(const String&, Arrivals*)
+  {
+  }
+
+  void Watcher::Rescan(const Report& report)
+  {
+    report(m_renamer.Run());
+  }
+
+  void Watcher::Run(const std::atomic<bool>&, const Report&)
+  {
+    throw Error("watch mode needs inotify, which this platform doesn't have", m_options.path, 0);
+  }
+
+#endif // __linux__
+
+}
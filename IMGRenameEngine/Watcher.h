@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <functional>       // For std::function
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "Engine.h"
+
+namespace Engine
+{
+
+  // Long-running mode: after one full run, rename matching files as they arrive. Events are collected for a short
+  // latency window and renamed per directory in one batch; a kernel queue overflow falls back to a full rescan.
+  // Needs inotify, so Linux only; elsewhere Run() throws.
+  class Watcher
+  {
+  public:
+    using Report = std::function<void(const Result&)>;
+
+    Watcher(const Options& options, unsigned latency = 20);   // latency in ms: how long to wait for more events before renaming
+    void Run(const std::atomic<bool>& stop, const Report& report);   // until stop is set; throws Error if watching can't start
+
+  private:
+    using Arrivals = std::map<String, std::vector<String>>;   // directory -> names to rename; ordered, so batches are reproducible
+
+    void Watch(const String& path, Arrivals* found = nullptr);   // add a watch for path and, with subdir, everything below it; found: collect the matching files met on the way
+    void Rescan(const Report& report);
+
+  private:
+    Options m_options;
+    unsigned m_latency;
+    Renamer m_renamer;
+    int m_fd{ -1 };
+    std::unordered_map<int, String> m_watches;           // watch descriptor -> directory
+    RuleSet m_echoes;                                    // new prefixes that would match again
+  };
+
+}
@@ -0,0 +1,117 @@
+#include "WorkPool.h"
+
+namespace Engine
+{
+
+  static thread_local const WorkPool* t_pool{};         // pool the current thread works for, if any
+  static thread_local size_t t_self{};                   // index of the current worker in that pool
+
+  WorkPool::WorkPool(unsigned threads)
+  {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (unsigned i = 0; i < threads; ++i) m_queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < threads; ++i) m_threads.emplace_back(&WorkPool::Worker, this, i);
+  }
+
+  WorkPool::~WorkPool()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      m_stop = true;
+    }
+    m_work.notify_all();
+    for (std::thread& t : m_threads) t.join();
+  }
+
+  void WorkPool::Submit(Task task)
+  {
+    size_t target = (t_pool == this) ? t_self : m_next++ % m_queues.size();
+    ++m_pending;
+    {
+      std::lock_guard<std::mutex> guard(m_queues[target]->lock);
+      m_queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> guard(m_lock);         // pairs with the predicate check in Worker(), so no wake-up is lost
+      ++m_queued;
+    }
+    m_work.notify_one();
+  }
+
+  void WorkPool::Wait()
+  {
+    std::unique_lock<std::mutex> guard(m_lock);
+    m_done.wait(guard, [this] { return m_pending == 0; });
+    if (m_error)
+    {
+      std::exception_ptr error = m_error;
+      m_error = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+  bool WorkPool::Pop(size_t self, Task& task)
+  {
+    Queue& q = *m_queues[self];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty()) return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+  }
+
+  bool WorkPool::Steal(size_t self, Task& task)
+  {
+    for (size_t i = 1; i < m_queues.size(); ++i)
+    {
+      Queue& q = *m_queues[(self + i) % m_queues.size()];
+      std::lock_guard<std::mutex> guard(q.lock);
+      if (q.tasks.empty()) continue;
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+      return true;
+    }
+    return false;
+  }
+
+  void WorkPool::Finished()
+  {
+    if (--m_pending == 0)
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      m_done.notify_all();
+    }
+  }
+
+  void WorkPool::Worker(size_t self)
+  {
+    t_pool = this;
+    t_self = self;
+    for (;;)
+    {
+      Task task{};
+      if (Pop(self, task) || Steal(self, task))
+      {
+        --m_queued;
+        try
+        {
+          task();
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> guard(m_lock);
+          if (!m_error) m_error = std::current_exception();
+        }
+        Finished();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> guard(m_lock);
+      m_work.wait(guard, [this] { return m_stop || m_queued > 0; });
+      if (m_stop) return;
+    }
+  }
+
+}
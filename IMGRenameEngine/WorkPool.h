@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>        // For std::exception_ptr
+#include <functional>       // For std::function
+#include <memory>           // For std::unique_ptr
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine
+{
+
+  // Fixed set of worker threads, each with its own task deque. A worker runs its newest task first (depth-first,
+  // cache friendly) and, when it runs dry, steals the oldest task of another worker (the biggest unexplored subtree).
+  class WorkPool
+  {
+  public:
+    using Task = std::function<void()>;
+
+    explicit WorkPool(unsigned threads);                 // 0 = one per hardware thread
+    ~WorkPool();
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    void Submit(Task task);                              // from a worker: onto its own deque; from outside: round robin
+    void Wait();                                         // block until all tasks, including the ones they submitted, are done; rethrows the first escaped exception
+    unsigned Threads() const { return static_cast<unsigned>(m_threads.size()); }
+
+  private:
+    struct Queue
+    {
+      std::mutex lock;
+      std::deque<Task> tasks;
+    };
+
+    void Worker(size_t self);
+    bool Pop(size_t self, Task& task);                   // newest task of our own deque
+    bool Steal(size_t self, Task& task);                 // oldest task of somebody else's deque
+    void Finished();
+
+  private:
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_queued{};                      // tasks sitting in a deque
+    std::atomic<size_t> m_pending{};                     // tasks submitted and not yet finished
+    std::atomic<size_t> m_next{};                        // round robin target for outside submissions
+    std::mutex m_lock;                                   // guards the sleep / wake-up below and m_error
+    std::condition_variable m_work;
+    std::condition_variable m_done;
+    std::exception_ptr m_error{};
+    bool m_stop{};
+  };
+
+}
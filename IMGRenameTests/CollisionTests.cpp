@@ -0,0 +1,115 @@
+// CollisionTests.cpp : what a run does when a new name is already taken
+//
+
+#include <vector>
+
+#include "Engine.h"
+#include "Plan.h"
+#include "Test.h"
+
+static Engine::Options Policy(const Test::TempDir& dir, Engine::Collision collision)
+{
+  Engine::Options options{};
+  options.path = dir.Path();
+  options.from = IMG_TEXT("IMG_");
+  options.to = IMG_TEXT("DSC_");
+  options.collision = collision;
+  return options;
+}
+
+// IMG_1 and IMG_2 are to become DSC_1 and DSC_2; DSC_1 is there already
+static void Collide(const Test::TempDir& dir)
+{
+  dir.Touch(IMG_TEXT("IMG_1.JPG"), "new");
+  dir.Touch(IMG_TEXT("IMG_2.JPG"));
+  dir.Touch(IMG_TEXT("DSC_1.JPG"), "old");
+}
+
+TEST(Collision_AbortLeavesTheDirectoryAlone)
+{
+  Test::TempDir dir{};
+  Collide(dir);
+  Engine::Result result = Engine::Renamer(Policy(dir, Engine::Collision::Abort)).Run();
+  CHECK_EQ(result.renamed, 0u);
+  CHECK_EQ(result.collisions, 1u);
+  CHECK_EQ(result.failures.size(), 1u);
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("DSC_1.JPG"), IMG_TEXT("IMG_1.JPG"), IMG_TEXT("IMG_2.JPG") }));
+}
+
+TEST(Collision_SkipLeavesOnlyTheColliding)
+{
+  Test::TempDir dir{};
+  Collide(dir);
+  Engine::Result result = Engine::Renamer(Policy(dir, Engine::Collision::Skip)).Run();
+  CHECK_EQ(result.renamed, 1u);
+  CHECK_EQ(result.collisions, 1u);
+  CHECK(result.failures.empty());
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("DSC_1.JPG"), IMG_TEXT("DSC_2.JPG"), IMG_TEXT("IMG_1.JPG") }));
+}
+
+TEST(Collision_SuffixBeforeTheExtension)
+{
+  Test::TempDir dir{};
+  Collide(dir);
+  dir.Touch(IMG_TEXT("DSC_1_1.JPG"));                    // the first suffix is taken too
+  Engine::Result result = Engine::Renamer(Policy(dir, Engine::Collision::Suffix)).Run();
+  CHECK_EQ(result.renamed, 2u);
+  CHECK(result.failures.empty());
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("DSC_1.JPG"), IMG_TEXT("DSC_1_1.JPG"), IMG_TEXT("DSC_1_2.JPG"), IMG_TEXT("DSC_2.JPG") }));
+}
+
+// a raw file with a JPEG and an XMP sidecar, and a file of its own
+static void Sidecars(const Test::TempDir& dir)
+{
+  dir.Touch(IMG_TEXT("IMG_1234.CR2"));
+  dir.Touch(IMG_TEXT("IMG_1234.JPG"));
+  dir.Touch(IMG_TEXT("IMG_1234.CR2.xmp"));
+  dir.Touch(IMG_TEXT("IMG_5.JPG"));
+}
+
+static Engine::Options Grouped(const Test::TempDir& dir, Engine::Collision collision)
+{
+  Engine::Options options = Policy(dir, collision);
+  options.sidecars = true;
+  return options;
+}
+
+TEST(Collision_SidecarsGoWithTheirRawFile)
+{
+  Test::TempDir dir{};
+  Sidecars(dir);
+  dir.Touch(IMG_TEXT("DSC_1234.JPG"));                   // the group moves on to _1 as a whole
+  Engine::Result result = Engine::Renamer(Grouped(dir, Engine::Collision::Suffix)).Run();
+  CHECK_EQ(result.renamed, 4u);
+  CHECK(result.failures.empty());
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("DSC_1234.JPG"), IMG_TEXT("DSC_1234_1.CR2"), IMG_TEXT("DSC_1234_1.CR2.xmp"),
+                                              IMG_TEXT("DSC_1234_1.JPG"), IMG_TEXT("DSC_5.JPG") }));
+}
+
+TEST(Collision_SkipLeavesTheWholeGroup)
+{
+  Test::TempDir dir{};
+  Sidecars(dir);
+  dir.Touch(IMG_TEXT("DSC_1234.CR2.xmp"));               // only the sidecar's new name is taken
+  Engine::Result result = Engine::Renamer(Grouped(dir, Engine::Collision::Skip)).Run();
+  CHECK_EQ(result.renamed, 1u);
+  CHECK_EQ(result.collisions, 1u);
+  CHECK(result.failures.empty());
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("DSC_1234.CR2.xmp"), IMG_TEXT("DSC_5.JPG"), IMG_TEXT("IMG_1234.CR2"),
+                                              IMG_TEXT("IMG_1234.CR2.xmp"), IMG_TEXT("IMG_1234.JPG") }));
+}
+
+TEST(Collision_FailedMemberTakesBackItsGroup)
+{
+  Test::TempDir dir{};
+  Sidecars(dir);
+  Engine::Renamer renamer(Grouped(dir, Engine::Collision::Abort));
+  Engine::Plan plan{};
+  CHECK(renamer.BuildPlan(plan).failures.empty());
+  dir.Touch(IMG_TEXT("DSC_1234.JPG"), "late");           // taken between plan and apply: the JPEG goes last and fails
+  Engine::Result result = renamer.Apply(plan);
+  CHECK_EQ(result.renamed, 1u);
+  CHECK_EQ(result.failures.size(), 1u);
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("DSC_1234.JPG"), IMG_TEXT("DSC_5.JPG"), IMG_TEXT("IMG_1234.CR2"),
+                                              IMG_TEXT("IMG_1234.CR2.xmp"), IMG_TEXT("IMG_1234.JPG") }));
+}
@@ -0,0 +1,112 @@
+// DirIndexTests.cpp : the index of settled directories, saved, loaded and distrusted when damaged
+//
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "DirIndex.h"
+#include "Engine.h"
+#include "Test.h"
+
+using Engine::DirIndex;
+using Engine::Signature;
+
+static const String Key{ IMG_TEXT("key") };
+static const Signature Stamp{ 1, 2, 3, 4 };
+
+static String Saved(const Test::TempDir& dir)
+{
+  String file = dir / IMG_TEXT("index");
+  DirIndex index{};
+  index.Load(file, Key);
+  index.Settled(IMG_TEXT("/photos/a"), Stamp, { IMG_TEXT("x"), IMG_TEXT("y") });
+  index.Settled(IMG_TEXT("/photos/b"), Stamp, {});
+  index.Save();
+  return file;
+}
+
+static bool Known(const String& file, const String& key)
+{
+  DirIndex index{};
+  index.Load(file, key);
+  std::vector<String> subdirs{};
+  return index.Unchanged(IMG_TEXT("/photos/a"), Stamp, subdirs) && subdirs == std::vector<String>{ IMG_TEXT("x"), IMG_TEXT("y") };
+}
+
+TEST(DirIndex_RoundTrip)
+{
+  Test::TempDir dir{};
+  String file = Saved(dir);
+  CHECK(Known(file, Key));
+
+  DirIndex index{};
+  index.Load(file, Key);
+  std::vector<String> subdirs{};
+  CHECK(index.Unchanged(IMG_TEXT("/photos/b"), Stamp, subdirs));
+  CHECK(subdirs.empty());
+  CHECK(!index.Unchanged(IMG_TEXT("/photos/b"), Signature{ 1, 2, 5, 4 }, subdirs));   // modified since
+  CHECK(!index.Unchanged(IMG_TEXT("/photos/c"), Stamp, subdirs));
+}
+
+TEST(DirIndex_OtherParametersStartEmpty)
+{
+  Test::TempDir dir{};
+  CHECK(!Known(Saved(dir), IMG_TEXT("other key")));
+}
+
+TEST(DirIndex_DamageThrowsItAway)
+{
+  Test::TempDir dir{};
+  String file = Saved(dir);
+  auto size = std::filesystem::file_size(std::filesystem::path(file));
+
+  // every single byte flipped, one at a time, is noticed
+  for (std::uintmax_t at = 8; at < size; ++at)
+  {
+    std::fstream f(std::filesystem::path(file), std::ios::in | std::ios::out | std::ios::binary);
+    f.seekg(static_cast<std::streamoff>(at));
+    char c = static_cast<char>(f.get());
+    f.seekp(static_cast<std::streamoff>(at));
+    f.put(static_cast<char>(c ^ 0x20));
+    f.close();
+    CHECK(!Known(file, Key));
+    f.open(std::filesystem::path(file), std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(static_cast<std::streamoff>(at));
+    f.put(c);
+  }
+  CHECK(Known(file, Key));
+
+  // and so is a file cut short anywhere
+  for (std::uintmax_t keep : { size - 1, size - 9, size / 2 })
+  {
+    String copy = dir / IMG_TEXT("cut");
+    std::filesystem::copy_file(std::filesystem::path(file), std::filesystem::path(copy), std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file(std::filesystem::path(copy), keep);
+    CHECK(!Known(copy, Key));
+  }
+}
+
+TEST(DirIndex_UnchangedDirectoriesAreNotListed)
+{
+  Test::TempDir photos{}, dir{};
+  std::filesystem::create_directory(std::filesystem::path(photos / IMG_TEXT("sub")));
+  photos.Touch(IMG_TEXT("sub/notes.txt"));
+  Engine::Options options{};
+  options.path = photos.Path();
+  options.from = IMG_TEXT("IMG_");
+  options.to = IMG_TEXT("DSC_");
+  options.subdir = true;
+  options.index = dir / IMG_TEXT("index");
+
+  Engine::Result first = Engine::Renamer(options).Run();
+  CHECK_EQ(first.directories, 2u);
+  Engine::Result second = Engine::Renamer(options).Run();
+  CHECK_EQ(second.unchanged, 2u);
+  CHECK_EQ(second.directories, 0u);
+
+  photos.Touch(IMG_TEXT("sub/IMG_1.JPG"));               // changes sub, not its parent
+  Engine::Result third = Engine::Renamer(options).Run();
+  CHECK_EQ(third.renamed, 1u);
+  CHECK_EQ(third.unchanged, 1u);
+}
@@ -0,0 +1,47 @@
+// DuplicatesTests.cpp : content hash and duplicate detection
+//
+
+#include <cstdint>          // For uint64_t
+#include <cstring>          // For strlen()
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Duplicates.h"
+#include "Test.h"
+
+TEST(Duplicates_Hash64KnownAnswers)
+{
+  // from the reference implementation, seed 0; the last one is long enough for the four lane loop
+  static const struct { const char* text; uint64_t hash; } vectors[]{
+    { "", 0xEF46DB3751D8E999ull },
+    { "a", 0xD24EC4F1A98C6E5Bull },
+    { "abc", 0x44BC2CF5AD770999ull },
+    { "Nobody inspects the spammish repetition", 0xFBCEA83C8A378BF1ull },
+  };
+  for (const auto& v : vectors) CHECK_EQ(Engine::Hash64(v.text, strlen(v.text), 0), v.hash);
+  CHECK(Engine::Hash64("abc", 3, 1) != Engine::Hash64("abc", 3, 0));
+}
+
+TEST(Duplicates_FindsCopiesOnly)
+{
+  Test::TempDir dir{};
+  std::string photo(20000, 'x'), other(photo);
+  other[10000] = 'y';                                    // same size, same first and last blocks: only the full hash tells
+  dir.Touch(IMG_TEXT("a.jpg"), photo);
+  dir.Touch(IMG_TEXT("b.jpg"), other);
+  dir.Touch(IMG_TEXT("c.jpg"), photo);
+  dir.Touch(IMG_TEXT("d.jpg"), std::string(20000, 'z'));
+  dir.Touch(IMG_TEXT("e.jpg"), "small");
+  std::filesystem::create_hard_link(std::filesystem::path(dir / IMG_TEXT("d.jpg")), std::filesystem::path(dir / IMG_TEXT("f.jpg")));
+  dir.Touch(IMG_TEXT("g.xmp"), "small");                 // read whole: the bytes are compared, not just the hash
+  dir.Touch(IMG_TEXT("h.xmp"), "smell");
+
+  std::vector<String> paths{ dir / IMG_TEXT("a.jpg"), dir / IMG_TEXT("b.jpg"), dir / IMG_TEXT("c.jpg"), dir / IMG_TEXT("d.jpg"),
+    dir / IMG_TEXT("e.jpg"), dir / IMG_TEXT("f.jpg"), dir / IMG_TEXT("missing.jpg"), dir / IMG_TEXT("g.xmp"), dir / IMG_TEXT("h.xmp") };
+  Engine::DuplicateStats stats{};
+  std::vector<size_t> first = Engine::FindDuplicates(paths, nullptr, nullptr, nullptr, stats);
+  CHECK_EQ(first, (std::vector<size_t>{ 0, 1, 0, 3, 4, 3, 6, 4, 8 }));
+  CHECK_EQ(stats.duplicates, 3u);
+  CHECK_EQ(stats.hashed, 3u);                            // a, b and c; d and f are one file
+}
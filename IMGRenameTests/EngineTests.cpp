@@ -0,0 +1,171 @@
+// EngineTests.cpp : Renamer runs against real directories
+//
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+#include "Engine.h"
+#include "Test.h"
+
+using Engine::Options;
+using Engine::Renamer;
+using Engine::Result;
+
+static Options Rename(const Test::TempDir& dir, const Char* from, const Char* to)
+{
+  Options options{};
+  options.path = dir.Path();
+  options.from = from;
+  options.to = to;
+  return options;
+}
+
+// every file and directory below dir, relative to it, sorted
+static std::vector<String> Tree(const Test::TempDir& dir)
+{
+  std::vector<String> tree;
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(std::filesystem::path(dir.Path())))
+  {
+    tree.push_back(std::filesystem::path(entry.path()).lexically_relative(std::filesystem::path(dir.Path())).native());
+  }
+  std::sort(tree.begin(), tree.end());
+  return tree;
+}
+
+// a few directories of matching and other files, with a taken name in one of them
+static void Photos(const Test::TempDir& dir)
+{
+  for (const Char* sub : { IMG_TEXT("a"), IMG_TEXT("b"), IMG_TEXT("b/c") })
+  {
+    std::filesystem::create_directory(std::filesystem::path(dir / sub));
+    for (const Char* name : { IMG_TEXT("/IMG_1.JPG"), IMG_TEXT("/IMG_2.CR2"), IMG_TEXT("/notes.txt") }) dir.Touch(String(sub) + name);
+  }
+  dir.Touch(IMG_TEXT("IMG_3.JPG"));
+  dir.Touch(IMG_TEXT("b/DSC_1.JPG"));
+}
+
+TEST(Engine_RenamesMatchingFilesOnly)
+{
+  Test::TempDir dir{};
+  dir.Touch(IMG_TEXT("IMG_0001.JPG"));
+  dir.Touch(IMG_TEXT("IMG_0002.JPG"));
+  dir.Touch(IMG_TEXT("notes.txt"));
+
+  Result result = Renamer(Rename(dir, IMG_TEXT("IMG_"), IMG_TEXT("DSC_"))).Run();
+  CHECK_EQ(result.renamed, 2u);
+  CHECK(result.failures.empty());
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("DSC_0001.JPG"), IMG_TEXT("DSC_0002.JPG"), IMG_TEXT("notes.txt") }));
+}
+
+TEST(Engine_SubdirectoriesOnlyWhenAsked)
+{
+  Test::TempDir dir{};
+  std::filesystem::create_directory(std::filesystem::path(dir / IMG_TEXT("sub")));
+  dir.Touch(IMG_TEXT("sub/IMG_1.JPG"));
+
+  Options options = Rename(dir, IMG_TEXT("IMG_"), IMG_TEXT("DSC_"));
+  CHECK_EQ(Renamer(options).Run().renamed, 0u);
+  options.subdir = true;
+  Result result = Renamer(options).Run();
+  CHECK_EQ(result.renamed, 1u);
+  CHECK_EQ(result.directories, 2u);
+  CHECK(std::filesystem::exists(std::filesystem::path(dir / IMG_TEXT("sub/DSC_1.JPG"))));
+}
+
+TEST(Engine_MissingDirectoryIsAFailure)
+{
+  Test::TempDir dir{};
+  Options options{};
+  options.path = dir / IMG_TEXT("missing");
+  options.from = IMG_TEXT("IMG_");
+  options.to = IMG_TEXT("DSC_");
+  Result result = Renamer(options).Run();
+  CHECK_EQ(result.renamed, 0u);
+  CHECK_EQ(result.failures.size(), 1u);
+}
+
+TEST(Engine_PipelineDoesWhatPlanAndApplyDo)
+{
+  Test::TempDir planned{}, piped{};
+  Photos(planned);
+  Photos(piped);
+
+  Options options = Rename(planned, IMG_TEXT("IMG_"), IMG_TEXT("DSC_"));
+  options.subdir = true;
+  options.collision = Engine::Collision::Skip;
+  Result expected = Renamer(options).Run();
+  options.path = piped.Path();
+  options.pipeline = true;
+  options.readers = 2;
+  options.renamers = 2;
+  Result result = Renamer(options).Run();
+
+  CHECK_EQ(expected.renamed, 6u);
+  CHECK_EQ(expected.collisions, 1u);
+  CHECK_EQ(result.directories, expected.directories);
+  CHECK_EQ(result.planned, expected.planned);
+  CHECK_EQ(result.renamed, expected.renamed);
+  CHECK_EQ(result.skipped, expected.skipped);
+  CHECK_EQ(result.collisions, expected.collisions);
+  CHECK_EQ(result.failures.size(), expected.failures.size());
+  CHECK(!result.stages.empty());
+  CHECK_EQ(Tree(piped), Tree(planned));
+}
+
+TEST(Engine_StreamingStaysUnderTheMemoryLimit)
+{
+  Test::TempDir dir{}, state{};
+  for (int i = 0; i < 5000; ++i) dir.Touch(IMG_TEXT("IMG_") + Engine::ToString(i) + IMG_TEXT(".JPG"));   // more than one chunk
+  for (const Char* sub : { IMG_TEXT("a"), IMG_TEXT("b") })
+  {
+    std::filesystem::create_directory(std::filesystem::path(dir / sub));
+    dir.Touch(String(sub) + IMG_TEXT("/IMG_1.JPG"));
+  }
+
+  Options options = Rename(dir, IMG_TEXT("IMG_"), IMG_TEXT("DSC_"));
+  options.subdir = true;
+  options.streaming = true;
+  options.memoryLimit = 1024 * 1024;
+  options.journal = state / IMG_TEXT("journal");        // keeps the subdirectory names for the journal as well
+  Result result = Renamer(options).Run();
+  CHECK(result.failures.empty());
+  CHECK_EQ(result.renamed, 5002u);
+  CHECK_EQ(result.directories, 3u);
+  CHECK(result.memoryPeak > 0);
+  CHECK(result.memoryPeak <= options.memoryLimit);
+  CHECK(std::filesystem::exists(std::filesystem::path(dir / IMG_TEXT("b/DSC_1.JPG"))));
+  CHECK_EQ(dir.Names().size(), 5002u);
+  CHECK_EQ(dir.Names().front(), String(IMG_TEXT("DSC_0.JPG")));
+
+  options.memoryLimit = 64 * 1024;                       // not even the read buffer and one small chunk
+  options.journal.clear();
+  result = Renamer(options).Run();
+  CHECK_EQ(result.renamed, 0u);
+  CHECK_EQ(result.failures.size(), 1u);
+}
+
+#ifndef _WIN32                                           // symbolic links need extra rights on Windows
+TEST(Engine_LinkLoopsAreWalkedOnce)
+{
+  Test::TempDir dir{};
+  std::filesystem::create_directory(std::filesystem::path(dir / IMG_TEXT("sub")));
+  dir.Touch(IMG_TEXT("IMG_1.JPG"));
+  dir.Touch(IMG_TEXT("sub/IMG_2.JPG"));
+  std::filesystem::create_directory_symlink(std::filesystem::path(dir.Path()), std::filesystem::path(dir / IMG_TEXT("sub/up")));   // sub/up/sub/up/...
+
+  Options options = Rename(dir, IMG_TEXT("IMG_"), IMG_TEXT("DSC_"));
+  options.subdir = true;
+  for (unsigned threads : { 1u, 4u })
+  {
+    options.threads = threads;
+    Result result = Renamer(options).Run();
+    CHECK(result.failures.empty());
+    CHECK_EQ(result.directories, 2u);
+    CHECK_EQ(result.revisited, 1u);
+    std::swap(options.from, options.to);                 // and back again for the next round
+  }
+  CHECK(dir.Exists(IMG_TEXT("IMG_1.JPG")));
+  CHECK(dir.Exists(IMG_TEXT("sub/IMG_2.JPG")));
+}
+#endif
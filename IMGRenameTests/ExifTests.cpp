@@ -0,0 +1,180 @@
+// ExifTests.cpp : EXIF fields read from a file head, and names built from them
+//
+
+#include <cstddef>          // For std::ptrdiff_t
+#include <cstdint>          // For uint32_t
+#include <cstring>          // For strcpy()
+#include <string>
+#include <vector>
+
+#include "Engine.h"
+#include "Exif.h"
+#include "Template.h"
+#include "Test.h"
+
+using Engine::Exif;
+using Engine::NameTemplate;
+
+// a minimal TIFF: IFD0 with Model and the Exif IFD pointer, the Exif IFD with DateTimeOriginal and SubSecTimeOriginal
+class TiffWriter
+{
+public:
+  explicit TiffWriter(bool big) : m_big(big) {}
+
+  std::vector<unsigned char> Build(const std::string& model, const std::string& date, const std::string& subSec)
+  {
+    const uint32_t ifd0 = 8, exifIfd = ifd0 + 2 + 2 * 12 + 4, data = exifIfd + 2 + 2 * 12 + 4;
+    Raw(m_big ? "MM\0*" : "II*\0", 4);
+    U32(ifd0);
+
+    U16(2);
+    Entry(0x0110, 2, static_cast<uint32_t>(model.size() + 1), data);
+    Entry(0x8769, 4, 1, exifIfd);
+    U32(0);
+
+    U16(2);
+    Entry(0x9003, 2, static_cast<uint32_t>(date.size() + 1), static_cast<uint32_t>(data + model.size() + 1));
+    U16(0x9291);                                         // at most 3 digits and the NUL: stored in the entry itself
+    U16(2);
+    U32(static_cast<uint32_t>(subSec.size() + 1));
+    Raw(subSec.c_str(), subSec.size() + 1);
+    Raw("\0\0\0", 3 - subSec.size());
+    U32(0);
+
+    Raw(model.c_str(), model.size() + 1);
+    Raw(date.c_str(), date.size() + 1);
+    return m_bytes;
+  }
+
+private:
+  void Raw(const char* p, size_t n) { m_bytes.insert(m_bytes.end(), p, p + n); }
+  void U16(uint32_t v) { Bytes(v, 2); }
+  void U32(uint32_t v) { Bytes(v, 4); }
+  void Bytes(uint32_t v, unsigned n)
+  {
+    for (unsigned i = 0; i < n; ++i) m_bytes.push_back(static_cast<unsigned char>(v >> 8 * (m_big ? n - 1 - i : i)));
+  }
+  void Entry(uint32_t tag, uint32_t type, uint32_t count, uint32_t value)
+  {
+    U16(tag);
+    U16(type);
+    U32(count);
+    U32(value);
+  }
+
+private:
+  bool m_big;
+  std::vector<unsigned char> m_bytes{};
+};
+
+// the TIFF in the APP1 segment of a JPEG, behind an APP0 one
+static std::vector<unsigned char> Jpeg(const std::vector<unsigned char>& tiff)
+{
+  std::vector<unsigned char> jpeg{ 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x06, 'J', 'F', 'I', 'F' };
+  size_t length = 2 + 6 + tiff.size();
+  jpeg.insert(jpeg.end(), { 0xFF, 0xE1, static_cast<unsigned char>(length >> 8), static_cast<unsigned char>(length), 'E', 'x', 'i', 'f', 0, 0 });
+  jpeg.insert(jpeg.end(), tiff.begin(), tiff.end());
+  jpeg.insert(jpeg.end(), { 0xFF, 0xDA, 0x00, 0x02, 0xFF, 0xD9 });
+  return jpeg;
+}
+
+TEST(Exif_ParsesTiffAndJpeg)
+{
+  for (bool big : { false, true })
+  {
+    std::vector<unsigned char> tiff = TiffWriter(big).Build("Canon EOS 6D  ", "2024:01:02 03:04:05", "42");
+    for (const std::vector<unsigned char>& file : { tiff, Jpeg(tiff) })
+    {
+      Exif exif{};
+      CHECK(exif.Parse(file.data(), file.size()));
+      CHECK_EQ(std::string(exif.model), std::string("Canon EOS 6D"));   // the padding blanks go
+      CHECK_EQ(std::string(exif.dateTimeOriginal), std::string("2024:01:02 03:04:05"));
+      CHECK_EQ(std::string(exif.subSecTime), std::string("42"));
+    }
+  }
+}
+
+TEST(Exif_CutOrForeignDataIsNoExif)
+{
+  std::vector<unsigned char> jpeg = Jpeg(TiffWriter(false).Build("X100V", "2024:01:02 03:04:05", "1"));
+  for (size_t size = 0; size < jpeg.size(); ++size)       // every cut parses within the bytes it has
+  {
+    std::vector<unsigned char> cut(jpeg.begin(), jpeg.begin() + static_cast<std::ptrdiff_t>(size));
+    Exif exif{};
+    if (exif.Parse(cut.data(), cut.size())) CHECK(exif.model[0] != 0 || exif.dateTimeOriginal[0] != 0);
+  }
+  const unsigned char png[]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n', 0, 0, 0, 0 };
+  Exif exif{};
+  CHECK(!exif.Parse(png, sizeof(png)));
+  CHECK(!exif.Read(IMG_TEXT("/nonexistent/IMG_0001.JPG")));
+}
+
+static String Expand(StringView text, const Exif& exif)
+{
+  Char out[64];
+  size_t n = NameTemplate(text).Expand(exif, out, 64);
+  return n == static_cast<size_t>(-1) ? String(IMG_TEXT("(missing)")) : String(out, n);
+}
+
+TEST(Exif_TemplateFields)
+{
+  Exif exif{};
+  strcpy(exif.dateTimeOriginal, "2024:01:02 03:04:05");
+  strcpy(exif.subSecTime, "42");
+  strcpy(exif.model, "EOS R5/C: \"mk*2\"");
+  CHECK_EQ(Expand(IMG_TEXT("{DateTimeOriginal}_"), exif), String(IMG_TEXT("20240102_030405_")));
+  CHECK_EQ(Expand(IMG_TEXT("{Year}/{Month}/{Day}"), exif), String(IMG_TEXT("2024/01/02")));
+  CHECK_EQ(Expand(IMG_TEXT("T{SubSecTime}"), exif), String(IMG_TEXT("T42")));
+  CHECK_EQ(Expand(IMG_TEXT("{Model}_"), exif), String(IMG_TEXT("EOS-R5-C---mk-2-_")));
+  CHECK_EQ(Expand(IMG_TEXT("{model}{Model"), exif), String(IMG_TEXT("{model}{Model")));   // not fields: copied
+  CHECK(NameTemplate(IMG_TEXT("Canon_")).Plain());
+  CHECK(!NameTemplate(IMG_TEXT("{Day}")).Plain());
+
+  Char small[4];
+  CHECK(NameTemplate(IMG_TEXT("{DateTimeOriginal}")).Expand(exif, small, 4) == static_cast<size_t>(-1));
+}
+
+TEST(Exif_TemplateFieldsMissing)
+{
+  Exif exif{};
+  strcpy(exif.dateTimeOriginal, "0000:00:00 00:00:00");   // camera clock never set
+  CHECK_EQ(Expand(IMG_TEXT("{DateTimeOriginal}"), exif), String(IMG_TEXT("(missing)")));
+  CHECK_EQ(Expand(IMG_TEXT("{Year}"), exif), String(IMG_TEXT("(missing)")));
+  CHECK_EQ(Expand(IMG_TEXT("{Model}"), exif), String(IMG_TEXT("(missing)")));
+  CHECK_EQ(Expand(IMG_TEXT("{SubSecTime}"), exif), String(IMG_TEXT("(missing)")));
+  CHECK_EQ(Expand(IMG_TEXT("plain"), exif), String(IMG_TEXT("plain")));
+}
+
+TEST(Exif_TemplateDatesOfTheWrongShape)
+{
+  static const char* const dates[]{ "2024:1:02 03:04:05", "2024-01-02 03:04:05", "2024:01", "2024:01:0", "    :  :     :  :  ", "20240102 030405" };
+  for (const char* date : dates)
+  {
+    Exif exif{};
+    strcpy(exif.dateTimeOriginal, date);
+    CHECK_EQ(Expand(IMG_TEXT("{DateTimeOriginal}"), exif), String(IMG_TEXT("(missing)")));
+    CHECK_EQ(Expand(IMG_TEXT("{Month}"), exif), String(IMG_TEXT("(missing)")));
+  }
+
+  // a good date with a bad or no time: enough for the folder fields only
+  for (const char* date : { "2024:01:02", "2024:01:02 03:04", "2024:01:02 3:04:05" })
+  {
+    Exif exif{};
+    strcpy(exif.dateTimeOriginal, date);
+    CHECK_EQ(Expand(IMG_TEXT("{Year}/{Month}/{Day}"), exif), String(IMG_TEXT("2024/01/02")));
+    CHECK_EQ(Expand(IMG_TEXT("{DateTimeOriginal}"), exif), String(IMG_TEXT("(missing)")));
+  }
+}
+
+TEST(Exif_RenamesFromTheFileHead)
+{
+  Test::TempDir dir{};
+  std::vector<unsigned char> jpeg = Jpeg(TiffWriter(false).Build("X100V", "2024:01:02 03:04:05", "7"));
+  dir.Touch(IMG_TEXT("IMG_0001.JPG"), std::string(jpeg.begin(), jpeg.end()));
+  dir.Touch(IMG_TEXT("IMG_0002.JPG"), "no exif in here");
+  Engine::Options options{};
+  options.path = dir.Path();
+  options.rules = { Engine::Rule{ IMG_TEXT("IMG_"), IMG_TEXT("{Model}_{DateTimeOriginal}_") } };
+  Engine::Renamer(options).Run();
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("IMG_0002.JPG"), IMG_TEXT("X100V_20240102_030405_0001.JPG") }));
+}
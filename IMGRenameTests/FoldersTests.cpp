@@ -0,0 +1,114 @@
+// FoldersTests.cpp : runs that move files into folders (Options::folders)
+//
+
+#include <algorithm>        // For std::sort
+#include <filesystem>
+#include <vector>
+
+#include "Engine.h"
+#include "Test.h"
+
+namespace fs = std::filesystem;
+
+static std::vector<String> Names(const String& directory)
+{
+  std::vector<String> names{};
+  for (const fs::directory_entry& entry : fs::directory_iterator(fs::path(directory))) names.push_back(entry.path().filename().native());
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+static Engine::Options Sorting(const Test::TempDir& dir, Engine::Collision collision)
+{
+  Engine::Options options{};
+  options.path = dir.Path();
+  options.from = IMG_TEXT("IMG_");
+  options.to = IMG_TEXT("X_");
+  options.subdir = true;
+  options.folders = IMG_TEXT("sorted");
+  options.collision = collision;
+  return options;
+}
+
+TEST(Folders_MovesAndMeetsWhatIsThere)
+{
+  Test::TempDir dir{};
+  fs::create_directory(fs::path(dir / IMG_TEXT("sorted")));
+  dir.Touch(IMG_TEXT("IMG_1.JPG"));
+  dir.Touch(IMG_TEXT("IMG_2.JPG"));
+  dir.Touch(IMG_TEXT("sorted/X_2.JPG"), "old");
+  Engine::Result result = Engine::Renamer(Sorting(dir, Engine::Collision::Suffix)).Run();
+  CHECK_EQ(result.renamed, 2u);
+  CHECK(result.failures.empty());
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("sorted") }));
+  CHECK_EQ(Names(dir / IMG_TEXT("sorted")), (std::vector<String>{ IMG_TEXT("X_1.JPG"), IMG_TEXT("X_2.JPG"), IMG_TEXT("X_2_1.JPG") }));
+}
+
+TEST(Folders_TargetRenamedInPlaceToo)
+{
+  // sorted is a folder files move into and a directory renamed in place: both give out X_1.JPG there
+  for (Engine::Collision collision : { Engine::Collision::Suffix, Engine::Collision::Skip })
+  {
+    Test::TempDir dir{};
+    fs::create_directory(fs::path(dir / IMG_TEXT("sorted")));
+    dir.Touch(IMG_TEXT("IMG_1.JPG"));
+    dir.Touch(IMG_TEXT("sorted/IMG_1.JPG"));
+    Engine::Result result = Engine::Renamer(Sorting(dir, collision)).Run();
+    CHECK(result.failures.empty());
+    CHECK_EQ(result.collisions, 1u);
+    if (collision == Engine::Collision::Suffix)
+    {
+      CHECK_EQ(result.renamed, 2u);
+      CHECK_EQ(Names(dir / IMG_TEXT("sorted")), (std::vector<String>{ IMG_TEXT("X_1.JPG"), IMG_TEXT("X_1_1.JPG") }));
+    }
+    else
+    {
+      CHECK_EQ(result.renamed, 1u);
+      CHECK_EQ(Names(dir / IMG_TEXT("sorted")).size() + dir.Names().size(), 3u);   // one of the two stayed where it was
+    }
+  }
+}
+
+TEST(Folders_AbortGivesBackItsClaims)
+{
+  // the root claims sorted/X_1.JPG, then finds X_2.JPG taken and stays as it is: a's IMG_1.JPG may have X_1.JPG
+  Test::TempDir dir{};
+  fs::create_directory(fs::path(dir / IMG_TEXT("sorted")));
+  fs::create_directory(fs::path(dir / IMG_TEXT("a")));
+  dir.Touch(IMG_TEXT("IMG_1.JPG"));
+  dir.Touch(IMG_TEXT("IMG_2.JPG"));
+  dir.Touch(IMG_TEXT("sorted/X_2.JPG"), "old");
+  dir.Touch(IMG_TEXT("a/IMG_1.JPG"));
+  Engine::Result result = Engine::Renamer(Sorting(dir, Engine::Collision::Abort)).Run();
+  CHECK_EQ(result.renamed, 1u);
+  CHECK_EQ(result.failures.size(), 1u);
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("IMG_1.JPG"), IMG_TEXT("IMG_2.JPG"), IMG_TEXT("a"), IMG_TEXT("sorted") }));
+  CHECK_EQ(Names(dir / IMG_TEXT("sorted")), (std::vector<String>{ IMG_TEXT("X_1.JPG"), IMG_TEXT("X_2.JPG") }));
+}
+
+TEST(Folders_UndoWithARelativeRoot)
+{
+  Test::TempDir dir{}, state{};
+  fs::create_directory(fs::path(dir / IMG_TEXT("photos")));
+  dir.Touch(IMG_TEXT("photos/IMG_1.JPG"));
+  dir.Touch(IMG_TEXT("photos/IMG_2.JPG"));
+
+  // run from next to the photos, as "IMGRenameCLI photos IMG_ X_ --folders sorted --journal ..." would
+  fs::path cwd = fs::current_path();
+  fs::current_path(fs::path(dir.Path()));
+  Engine::Options options{};
+  options.path = IMG_TEXT("photos");
+  options.from = IMG_TEXT("IMG_");
+  options.to = IMG_TEXT("X_");
+  options.folders = IMG_TEXT("sorted");
+  options.journal = state / IMG_TEXT("journal");
+  Engine::Result result = Engine::Renamer(options).Run();
+  fs::current_path(cwd);                                 // undo runs from wherever
+  CHECK_EQ(result.renamed, 2u);
+  CHECK_EQ(Names(dir / IMG_TEXT("photos/sorted")), (std::vector<String>{ IMG_TEXT("X_1.JPG"), IMG_TEXT("X_2.JPG") }));
+
+  Engine::Result undone = Engine::Renamer::Undo(options.journal);
+  CHECK_EQ(undone.renamed, 2u);
+  CHECK(undone.failures.empty());
+  CHECK_EQ(Names(dir / IMG_TEXT("photos")), (std::vector<String>{ IMG_TEXT("IMG_1.JPG"), IMG_TEXT("IMG_2.JPG"), IMG_TEXT("sorted") }));
+}
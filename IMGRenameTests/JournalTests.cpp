@@ -0,0 +1,195 @@
+// JournalTests.cpp : the rename journal written, read back, resumed from and undone
+//
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "Engine.h"
+#include "Journal.h"
+#include "Test.h"
+
+using Engine::Journal;
+
+static const String Root{ IMG_TEXT("/photos") };
+static const String Rules{ IMG_TEXT("IMG_ DSC_") };
+
+TEST(Journal_RoundTrip)
+{
+  Test::TempDir dir{};
+  String file = dir / IMG_TEXT("journal");
+  {
+    Journal j{};
+    j.Open(file, Root, Rules);
+    uint32_t a = j.Listed(IMG_TEXT("/photos/a"), { IMG_TEXT("x"), IMG_TEXT("y") });
+    uint32_t b = j.Listed(IMG_TEXT("/photos/b"), {});
+    j.Renaming(a, IMG_TEXT("IMG_1.JPG"), IMG_TEXT("DSC_1.JPG"));
+    j.Renaming(b, IMG_TEXT("IMG_2.JPG"), IMG_TEXT("DSC_2.JPG"));
+    j.Sync();
+    j.Done(a);
+  }
+
+  Journal j{};
+  j.Open(file, Root, Rules);
+  std::vector<String> subdirs{};
+  CHECK(j.Finished(IMG_TEXT("/photos/a"), subdirs));
+  CHECK_EQ(subdirs, (std::vector<String>{ IMG_TEXT("x"), IMG_TEXT("y") }));
+  CHECK(!j.Finished(IMG_TEXT("/photos/b"), subdirs));
+
+  std::vector<Journal::Rename> renames = j.Renames();
+  CHECK_EQ(renames.size(), 2u);
+  if (renames.size() == 2)
+  {
+    CHECK_EQ(renames[0].directory, String(IMG_TEXT("/photos/a")));
+    CHECK_EQ(renames[0].from, String(IMG_TEXT("IMG_1.JPG")));
+    CHECK_EQ(renames[1].to, String(IMG_TEXT("DSC_2.JPG")));
+  }
+  const std::vector<String>* targets = j.Targets(IMG_TEXT("/photos/b"));
+  CHECK(targets != nullptr && *targets == std::vector<String>{ IMG_TEXT("DSC_2.JPG") });
+  CHECK(j.Targets(IMG_TEXT("/photos/c")) == nullptr);
+}
+
+TEST(Journal_RevertTakesOutTheLatestRename)
+{
+  Test::TempDir dir{};
+  String file = dir / IMG_TEXT("journal");
+  {
+    Journal j{};
+    j.Open(file, Root, Rules);
+    uint32_t a = j.Listed(IMG_TEXT("/photos/a"), {});
+    j.Renaming(a, IMG_TEXT("IMG_1.JPG"), IMG_TEXT("DSC_1.JPG"));
+    j.Renaming(a, IMG_TEXT("IMG_2.JPG"), IMG_TEXT("DSC_2.JPG"));
+    j.Done(a);
+    j.Undone(Journal::Rename{ IMG_TEXT("/photos/a"), IMG_TEXT("IMG_1.JPG"), IMG_TEXT("DSC_1.JPG") });
+    j.Undone(Journal::Rename{ IMG_TEXT("/photos/a"), IMG_TEXT("IMG_9.JPG"), IMG_TEXT("DSC_9.JPG") });   // never recorded: ignored
+  }
+
+  Journal j{};
+  j.Open(file, Root, Rules);
+  std::vector<Journal::Rename> renames = j.Renames();
+  CHECK_EQ(renames.size(), 1u);
+  if (!renames.empty()) CHECK_EQ(renames[0].from, String(IMG_TEXT("IMG_2.JPG")));
+  std::vector<String> subdirs{};
+  CHECK(!j.Finished(IMG_TEXT("/photos/a"), subdirs));   // a revert means the directory has work to do again
+}
+
+TEST(Journal_TornRecordEndsTheLog)
+{
+  Test::TempDir dir{};
+  String file = dir / IMG_TEXT("journal");
+  {
+    Journal j{};
+    j.Open(file, Root, Rules);
+    uint32_t a = j.Listed(IMG_TEXT("/photos/a"), {});
+    j.Renaming(a, IMG_TEXT("IMG_1.JPG"), IMG_TEXT("DSC_1.JPG"));
+    j.Renaming(a, IMG_TEXT("IMG_2.JPG"), IMG_TEXT("DSC_2.JPG"));
+  }
+  // a crash in the middle of the last record: one byte of it differs
+  {
+    std::fstream f(std::filesystem::path(file), std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(-8, std::ios::end);
+    f.put('\x7f');
+  }
+
+  Journal j{};
+  j.Open(file, Root, Rules);
+  std::vector<Journal::Rename> renames = j.Renames();
+  CHECK_EQ(renames.size(), 1u);
+  if (!renames.empty()) CHECK_EQ(renames[0].from, String(IMG_TEXT("IMG_1.JPG")));
+}
+
+TEST(Journal_OtherRunsAreRefused)
+{
+  Test::TempDir dir{};
+  String file = dir / IMG_TEXT("journal");
+  {
+    Journal j{};
+    j.Open(file, Root, Rules);
+  }
+  Journal other{};
+  CHECK_THROWS(other.Open(file, IMG_TEXT("/elsewhere"), Rules));
+  Journal rules{};
+  CHECK_THROWS(rules.Open(file, Root, IMG_TEXT("A_ B_")));
+
+  dir.Touch(IMG_TEXT("notes.txt"), "not a journal");
+  Journal text{};
+  CHECK_THROWS(text.Open(dir / IMG_TEXT("notes.txt"), Root, Rules));
+  CHECK_EQ(std::filesystem::file_size(std::filesystem::path(dir / IMG_TEXT("notes.txt"))), 13u);
+}
+
+TEST(Journal_FinishedRunStartsANewOne)
+{
+  Test::TempDir dir{};
+  String file = dir / IMG_TEXT("journal");
+  {
+    Journal j{};
+    j.Open(file, Root, Rules);
+    uint32_t a = j.Listed(IMG_TEXT("/photos"), {});
+    j.Renaming(a, IMG_TEXT("IMG_1.JPG"), IMG_TEXT("DSC_1.JPG"));
+    j.Done(a);
+  }
+  for (int reopen = 0; reopen < 2; ++reopen)             // the second time, Load() finds the new run's header
+  {
+    Journal j{};
+    j.Open(file, Root, Rules);
+    std::vector<String> subdirs{};
+    CHECK(!j.Finished(IMG_TEXT("/photos"), subdirs));
+    CHECK(j.Targets(IMG_TEXT("/photos")) == nullptr);
+    CHECK_EQ(j.Renames().size(), 1u);                    // still there for Undo
+  }
+}
+
+static Engine::Options Journaled(const Test::TempDir& photos, const String& journal)
+{
+  Engine::Options options{};
+  options.path = photos.Path();
+  options.from = IMG_TEXT("IMG_");
+  options.to = IMG_TEXT("DSC_");
+  options.subdir = true;
+  options.journal = journal;
+  return options;
+}
+
+TEST(Journal_ResumeSkipsFinishedDirectories)
+{
+  Test::TempDir photos{}, dir{};
+  String journal = dir / IMG_TEXT("journal");
+  std::filesystem::create_directory(std::filesystem::path(photos / IMG_TEXT("done")));
+  photos.Touch(IMG_TEXT("IMG_1.JPG"));
+  photos.Touch(IMG_TEXT("done/IMG_2.JPG"));
+  Engine::Options options = Journaled(photos, journal);
+  {
+    // an interrupted run: the subdirectory went through, the root did not
+    Journal j{};
+    j.Open(journal, options.path, Engine::Renamer(options).Rules().Key());
+    j.Listed(options.path, { IMG_TEXT("done") });
+    j.Done(j.Listed(photos / IMG_TEXT("done"), {}));
+  }
+
+  Engine::Result result = Engine::Renamer(options).Run();
+  CHECK_EQ(result.renamed, 1u);
+  CHECK_EQ(result.resumed, 1u);
+  CHECK(photos.Exists(IMG_TEXT("DSC_1.JPG")));
+  CHECK(photos.Exists(IMG_TEXT("done/IMG_2.JPG")));
+}
+
+TEST(Journal_UndoRevertsTheRun)
+{
+  Test::TempDir photos{}, dir{};
+  String journal = dir / IMG_TEXT("journal");
+  for (int i = 0; i < 50; ++i) photos.Touch(IMG_TEXT("IMG_") + Engine::ToString(i) + IMG_TEXT(".JPG"));
+  std::vector<String> before = photos.Names();
+
+  CHECK_EQ(Engine::Renamer(Journaled(photos, journal)).Run().renamed, 50u);
+  CHECK(photos.Names() != before);
+  Engine::Result undone = Engine::Renamer::Undo(journal);
+  CHECK_EQ(undone.renamed, 50u);
+  CHECK(undone.failures.empty());
+  CHECK_EQ(photos.Names(), before);
+  CHECK_EQ(Engine::Renamer::Undo(journal).renamed, 0u);   // undone renames are on record as such
+
+  // once through, the same journal runs again: new files are renamed, not taken for finished
+  photos.Touch(IMG_TEXT("IMG_1000.JPG"));
+  CHECK_EQ(Engine::Renamer(Journaled(photos, journal)).Run().renamed, 51u);
+  CHECK(photos.Exists(IMG_TEXT("DSC_1000.JPG")));
+}
@@ -0,0 +1,96 @@
+// MetaCacheTests.cpp : the persistent EXIF cache across runs
+//
+
+#include <cstdint>          // For uint64_t
+#include <cstring>          // For strcpy()
+#include <string>
+
+#include "Exif.h"
+#include "MetaCache.h"
+#include "Test.h"
+
+using Engine::Exif;
+using Engine::FileId;
+using Engine::MetaCache;
+
+static FileId Id(uint64_t inode, uint64_t mtime = 1)
+{
+  return FileId{ 7, inode, 1000 + inode, mtime };
+}
+
+static Exif Fields(const char* model)
+{
+  Exif exif{};
+  strcpy(exif.model, model);
+  strcpy(exif.dateTimeOriginal, "2024:01:02 03:04:05");
+  return exif;
+}
+
+static std::string Model(MetaCache& cache, const FileId& id)
+{
+  Exif exif{};
+  return cache.Find(id, exif) ? std::string(exif.model) : std::string("-");
+}
+
+TEST(MetaCache_RoundTrip)
+{
+  Test::TempDir dir{};
+  String file = dir / IMG_TEXT("cache");
+  {
+    MetaCache cache{};
+    cache.Open(file, 100000);
+    for (uint64_t i = 1; i <= 5000; ++i) cache.Store(Id(i), Fields(i % 2 ? "odd" : "even"));   // grows past the first table
+    cache.Store(Id(5001), Exif{});                       // no EXIF: remembered as such
+    cache.Close();
+  }
+  MetaCache cache{};
+  cache.Open(file, 100000);
+  CHECK_EQ(Model(cache, Id(1)), std::string("odd"));
+  CHECK_EQ(Model(cache, Id(4000)), std::string("even"));
+  CHECK_EQ(Model(cache, Id(5001)), std::string(""));
+  CHECK_EQ(Model(cache, Id(5002)), std::string("-"));
+  CHECK_EQ(Model(cache, Id(1, 2)), std::string("-"));     // written to since
+  FileId other = Id(1);
+  other.device = 8;
+  CHECK_EQ(Model(cache, other), std::string("-"));
+
+  Exif exif{};
+  CHECK(cache.Find(Id(3), exif));
+  CHECK_EQ(std::string(exif.dateTimeOriginal), std::string("2024:01:02 03:04:05"));
+}
+
+TEST(MetaCache_OldestGoFirst)
+{
+  Test::TempDir dir{};
+  String file = dir / IMG_TEXT("cache");
+  MetaCache cache{};
+  cache.Open(file, 4);
+  for (uint64_t i = 1; i <= 4; ++i) cache.Store(Id(i), Fields("first"));
+  cache.Close();
+
+  cache.Open(file, 4);                                   // the second run uses 1 and 2 and brings 5 and 6
+  CHECK_EQ(Model(cache, Id(1)), std::string("first"));
+  CHECK_EQ(Model(cache, Id(2)), std::string("first"));
+  cache.Store(Id(5), Fields("second"));
+  cache.Store(Id(6), Fields("second"));
+  cache.Close();
+
+  cache.Open(file, 4);
+  CHECK_EQ(Model(cache, Id(3)), std::string("-"));
+  CHECK_EQ(Model(cache, Id(4)), std::string("-"));
+  CHECK_EQ(Model(cache, Id(1)), std::string("first"));
+  CHECK_EQ(Model(cache, Id(6)), std::string("second"));
+  cache.Close();
+}
+
+TEST(MetaCache_ForeignFileStartsOver)
+{
+  Test::TempDir dir{};
+  dir.Touch(IMG_TEXT("cache"), std::string(4096, 'x'));
+  MetaCache cache{};
+  cache.Open(dir / IMG_TEXT("cache"), 10);
+  CHECK_EQ(Model(cache, Id(1)), std::string("-"));
+  cache.Store(Id(1), Fields("new"));
+  CHECK_EQ(Model(cache, Id(1)), std::string("new"));
+  cache.Close();
+}
@@ -0,0 +1,65 @@
+// NameSetTests.cpp : the per-directory name set behind collision checks
+//
+
+#include <string>
+#include <vector>
+
+#include "NameSet.h"
+#include "Test.h"
+
+TEST(NameSet_InsertOnce)
+{
+  Engine::NameSet set(false);
+  CHECK(set.Insert(IMG_TEXT("IMG_0001.JPG")));
+  CHECK(!set.Insert(IMG_TEXT("IMG_0001.JPG")));
+  CHECK(set.Contains(IMG_TEXT("IMG_0001.JPG")));
+  CHECK(!set.Contains(IMG_TEXT("IMG_0002.JPG")));
+  CHECK_EQ(set.Size(), 1u);
+}
+
+TEST(NameSet_CaseRule)
+{
+  Engine::NameSet exact(false);
+  exact.Insert(IMG_TEXT("img_1.jpg"));
+  CHECK(!exact.Contains(IMG_TEXT("IMG_1.JPG")));
+  CHECK(exact.Insert(IMG_TEXT("IMG_1.JPG")));
+
+  Engine::NameSet folded(true);
+  folded.Insert(IMG_TEXT("img_1.jpg"));
+  CHECK(folded.Contains(IMG_TEXT("IMG_1.JPG")));
+  CHECK(!folded.Insert(IMG_TEXT("Img_1.Jpg")));
+  CHECK(folded.Same(IMG_TEXT("abc"), IMG_TEXT("ABC")));
+  CHECK(!folded.Same(IMG_TEXT("abc"), IMG_TEXT("abd")));
+}
+
+TEST(NameSet_GrowsPastReserve)
+{
+  std::vector<String> names{};
+  for (int i = 0; i < 5000; ++i) names.push_back(IMG_TEXT("IMG_") + Engine::ToString(i) + IMG_TEXT(".JPG"));
+
+  Engine::NameSet set(false);
+  set.Reserve(10);
+  for (const String& name : names) CHECK(set.Insert(name));
+  CHECK_EQ(set.Size(), names.size());
+  for (const String& name : names) CHECK(set.Contains(name));
+  CHECK(!set.Contains(IMG_TEXT("IMG_5000.JPG")));
+
+  set.Clear();
+  CHECK_EQ(set.Size(), 0u);
+  CHECK(!set.Contains(names[0]));
+}
+
+TEST(NameSet_EraseKeepsTheRest)
+{
+  std::vector<String> names{};
+  for (int i = 0; i < 1000; ++i) names.push_back(IMG_TEXT("IMG_") + Engine::ToString(i) + IMG_TEXT(".JPG"));
+
+  Engine::NameSet set(false);
+  set.Reserve(names.size());                             // at full load, so that runs of taken slots are long
+  for (const String& name : names) set.Insert(name);
+  for (size_t i = 0; i < names.size(); i += 2) CHECK(set.Erase(names[i]));
+  CHECK(!set.Erase(names[0]));
+  CHECK_EQ(set.Size(), names.size() / 2);
+  for (size_t i = 0; i < names.size(); ++i) CHECK_EQ(set.Contains(names[i]), i % 2 == 1);
+  CHECK(set.Insert(names[0]));
+}
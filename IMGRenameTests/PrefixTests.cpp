@@ -0,0 +1,106 @@
+// PrefixTests.cpp : the vector prefix test against the plain loop
+//
+
+#include <cstdint>          // For uint8_t
+#include <vector>
+
+#include "Prefix.h"
+#include "Test.h"
+
+using Engine::PrefixMatcher;
+
+// every name of up to 40 characters over a small alphabet that can match a prefix, and a few that can't
+static std::vector<String> Names(StringView prefix)
+{
+  static const Char alphabet[]{ IMG_TEXT('I'), IMG_TEXT('i'), IMG_TEXT('_'), IMG_TEXT('0'), IMG_TEXT('@'), IMG_TEXT('{') };
+  std::vector<String> names{};
+  for (size_t length = 0; length <= 40; ++length)
+  {
+    for (size_t cut = 0; cut <= prefix.size() && cut <= length; ++cut)
+    {
+      for (Char c : alphabet)
+      {
+        String name(prefix.substr(0, cut));
+        name.resize(length, c);
+        names.push_back(name);
+        for (Char& n : name)                             // the same in the other case
+        {
+          if (n >= IMG_TEXT('A') && n <= IMG_TEXT('Z')) n = static_cast<Char>(n + 0x20);
+          else if (n >= IMG_TEXT('a') && n <= IMG_TEXT('z')) n = static_cast<Char>(n - 0x20);
+        }
+        names.push_back(name);
+      }
+    }
+  }
+  return names;
+}
+
+TEST(Prefix_VectorAgreesWithTheLoop)
+{
+  static const StringView prefixes[]{ IMG_TEXT(""), IMG_TEXT("I"), IMG_TEXT("IMG_"), IMG_TEXT("img_"), IMG_TEXT("PXL_2024010"),
+    IMG_TEXT("IMG_IMG_IMG_IMG"), IMG_TEXT("IMG_IMG_IMG_IMG_"), IMG_TEXT("IMG_IMG_IMG_IMG_I"), IMG_TEXT("i_i_i_i_i_i_i_i_i_i_i_i_0") };
+  for (StringView prefix : prefixes)
+  {
+    for (bool fold : { false, true })
+    {
+      PrefixMatcher matcher(prefix, fold);
+      for (const String& name : Names(prefix))
+      {
+        // each name in a heap block of exactly its size, so a read past its end is a read past the block
+        std::vector<Char> exact(name.begin(), name.end());
+        StringView view(exact.data(), exact.size());
+        if (matcher.Match(view) != matcher.MatchScalar(view)) CHECK_EQ(name, String(IMG_TEXT("(agrees)")));
+      }
+    }
+  }
+}
+
+TEST(Prefix_BatchAgreesWithTheLoop)
+{
+  static const StringView prefixes[]{ IMG_TEXT("IMG_"), IMG_TEXT("img_"), IMG_TEXT("IMG_IMG_IMG_IMG_"), IMG_TEXT("i_i_i_i_i_i_i_i_i_i_i_i_0") };
+  for (StringView prefix : prefixes)
+  {
+    std::vector<String> names = Names(prefix);
+    // packed NUL terminated into one buffer, 16 spare bytes at the end, as in a directory scan
+    std::vector<Char> buffer{};
+    for (const String& name : names)
+    {
+      buffer.insert(buffer.end(), name.begin(), name.end());
+      buffer.push_back(Char{});
+    }
+    buffer.resize(buffer.size() + 16 / sizeof(Char));
+    std::vector<const Char*> pointers{};
+    for (size_t at = 0; pointers.size() < names.size(); at += names[pointers.size() - 1].size() + 1) pointers.push_back(buffer.data() + at);
+
+    for (bool fold : { false, true })
+    {
+      PrefixMatcher matcher(prefix, fold);
+      for (size_t count : { names.size(), names.size() - 1 })   // an odd and an even number, for the pairs of the AVX2 loop
+      {
+        std::vector<uint8_t> matches(count, 2);
+        size_t n = matcher.Match(pointers.data(), count, matches.data());
+        size_t expected = 0, wrong = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+          expected += matcher.MatchScalar(names[i]) ? 1 : 0;
+          wrong += matches[i] != (matcher.MatchScalar(names[i]) ? 1 : 0) ? 1 : 0;
+        }
+        CHECK_EQ(wrong, 0u);
+        CHECK_EQ(n, expected);
+      }
+    }
+  }
+}
+
+TEST(Prefix_CaseFoldingIsAsciiOnly)
+{
+  PrefixMatcher exact(IMG_TEXT("IMG_"), false), fold(IMG_TEXT("IMG_"), true);
+  CHECK(exact.Match(IMG_TEXT("IMG_0001.JPG")));
+  CHECK(!exact.Match(IMG_TEXT("img_0001.JPG")));
+  CHECK(fold.Match(IMG_TEXT("img_0001.JPG")));
+  CHECK(fold.Match(IMG_TEXT("ImG_")));
+  CHECK(!fold.Match(IMG_TEXT("IMG")));
+  CHECK(!fold.Match(IMG_TEXT("IMG\x7f")));                  // '_' + 0x20, not a letter
+  CHECK(PrefixMatcher(IMG_TEXT("@"), true).Match(IMG_TEXT("@")));
+  CHECK(!PrefixMatcher(IMG_TEXT("@"), true).Match(IMG_TEXT("`")));
+}
@@ -0,0 +1,92 @@
+// QueueTests.cpp : the bounded lock-free queue between pipeline stages
+//
+
+#include <thread>
+#include <vector>
+
+#include "Queue.h"
+#include "Test.h"
+
+using Engine::BoundedQueue;
+
+TEST(Queue_BoundedAndInOrder)
+{
+  BoundedQueue<int> queue(5);
+  CHECK_EQ(queue.Capacity(), 8u);                        // rounded up to a power of two
+  for (int i = 0; i < 8; ++i) CHECK(queue.TryPush(i));
+  CHECK(!queue.TryPush(8));
+  CHECK_EQ(queue.Size(), 8u);
+
+  int v = -1;
+  for (int i = 0; i < 8; ++i)
+  {
+    CHECK(queue.TryPop(v));
+    CHECK_EQ(v, i);
+  }
+  CHECK(!queue.TryPop(v));
+  for (int round = 0; round < 100; ++round)              // around the ring many times
+  {
+    CHECK(queue.TryPush(round));
+    CHECK(queue.TryPop(v));
+    CHECK_EQ(v, round);
+  }
+}
+
+TEST(Queue_PopEndsWhenClosedAndDrained)
+{
+  BoundedQueue<int> queue(4);
+  queue.Push(1);
+  queue.Push(2);
+  queue.Close();
+  int v = 0;
+  CHECK(queue.Pop(v));
+  CHECK_EQ(v, 1);
+  CHECK(queue.Pop(v));
+  CHECK_EQ(v, 2);
+  CHECK(!queue.Pop(v));
+}
+
+TEST(Queue_ManyProducersAndConsumers)
+{
+  // every value pushed is popped exactly once, and each producer's values come out in the order they went in
+  const int producers = 4, consumers = 3, each = 20000;
+  BoundedQueue<int> queue(16);
+  std::vector<std::vector<int>> popped(consumers);
+  std::vector<std::thread> threads{};
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads.emplace_back([&, c]
+      {
+        int v;
+        while (queue.Pop(v)) popped[c].push_back(v);
+      });
+  }
+  std::vector<std::thread> pushing{};
+  for (int p = 0; p < producers; ++p)
+  {
+    pushing.emplace_back([&, p]
+      {
+        for (int i = 0; i < each; ++i) queue.Push(p * each + i);
+      });
+  }
+  for (std::thread& t : pushing) t.join();
+  queue.Close();
+  for (std::thread& t : threads) t.join();
+
+  std::vector<int> seen(producers * each, 0);
+  bool ordered = true;
+  for (const std::vector<int>& values : popped)
+  {
+    std::vector<int> last(producers, -1);
+    for (int v : values)
+    {
+      ++seen[v];
+      if (v <= last[v / each]) ordered = false;
+      last[v / each] = v;
+    }
+  }
+  CHECK(ordered);
+  int once = 0;
+  for (int n : seen) once += n == 1 ? 1 : 0;
+  CHECK_EQ(once, producers * each);
+}
@@ -0,0 +1,103 @@
+// RulesTests.cpp : prefix rules, compiled and read from a rules file
+//
+
+#include <vector>
+
+#include "Engine.h"
+#include "Rules.h"
+#include "Test.h"
+
+using Engine::Rule;
+using Engine::RuleSet;
+
+static String To(const RuleSet& rules, StringView name)
+{
+  const Rule* rule = rules.Match(name);
+  return rule == nullptr ? String(IMG_TEXT("-")) : rule->to;
+}
+
+TEST(Rules_LongestPrefixWins)
+{
+  RuleSet rules({ Rule{ IMG_TEXT("IMG"), IMG_TEXT("a") }, Rule{ IMG_TEXT("IMG_"), IMG_TEXT("b") }, Rule{ IMG_TEXT("IMG_E"), IMG_TEXT("c") },
+    Rule{ IMG_TEXT("DSC"), IMG_TEXT("d") } });
+  CHECK_EQ(To(rules, IMG_TEXT("IMG_1234.JPG")), String(IMG_TEXT("b")));
+  CHECK_EQ(To(rules, IMG_TEXT("IMG_E1234.JPG")), String(IMG_TEXT("c")));
+  CHECK_EQ(To(rules, IMG_TEXT("IMGX.JPG")), String(IMG_TEXT("a")));
+  CHECK_EQ(To(rules, IMG_TEXT("DSC00001.ARW")), String(IMG_TEXT("d")));
+  CHECK_EQ(To(rules, IMG_TEXT("IM")), String(IMG_TEXT("-")));
+  CHECK_EQ(To(rules, IMG_TEXT("notes.txt")), String(IMG_TEXT("-")));
+  CHECK_EQ(To(rules, IMG_TEXT("")), String(IMG_TEXT("-")));
+}
+
+TEST(Rules_FirstOfEqualPrefixesAndNoEmptyOnes)
+{
+  RuleSet rules({ Rule{ IMG_TEXT(""), IMG_TEXT("x") }, Rule{ IMG_TEXT("A_"), IMG_TEXT("first") }, Rule{ IMG_TEXT("A_"), IMG_TEXT("second") } });
+  CHECK_EQ(rules.Rules().size(), 1u);
+  CHECK_EQ(To(rules, IMG_TEXT("A_1")), String(IMG_TEXT("first")));
+  CHECK_EQ(To(rules, IMG_TEXT("B_1")), String(IMG_TEXT("-")));
+  CHECK(RuleSet({ Rule{ IMG_TEXT(""), IMG_TEXT("x") } }).Empty());
+  CHECK(RuleSet{}.Match(IMG_TEXT("A_1")) == nullptr);
+}
+
+TEST(Rules_KeyTellsRuleSetsApart)
+{
+  RuleSet a({ Rule{ IMG_TEXT("A_"), IMG_TEXT("X_") } });
+  RuleSet b({ Rule{ IMG_TEXT("A_"), IMG_TEXT("Y_") } });
+  RuleSet c({ Rule{ IMG_TEXT("A_"), IMG_TEXT("X_") }, Rule{ IMG_TEXT("B_"), IMG_TEXT("X_") } });
+  CHECK(a.Key() != b.Key());
+  CHECK(a.Key() != c.Key());
+  CHECK(a.Key() == RuleSet({ Rule{ IMG_TEXT("A_"), IMG_TEXT("X_") } }).Key());
+}
+
+TEST(Rules_FileFormat)
+{
+  Test::TempDir dir{};
+  dir.Touch(IMG_TEXT("rules"), "# camera prefixes\n"
+    "\n"
+    "IMG_ Canon_\r\n"
+    "   DSC   Sony {Model} \t\n"
+    "P1\n"
+    "  # indented comment\n"
+    "_MG_ Canon_raw_");
+  std::vector<Rule> rules = Engine::LoadRules(dir / IMG_TEXT("rules"));
+  CHECK_EQ(rules.size(), 4u);
+  if (rules.size() != 4) return;
+  CHECK_EQ(rules[0].from, String(IMG_TEXT("IMG_")));
+  CHECK_EQ(rules[0].to, String(IMG_TEXT("Canon_")));
+  CHECK_EQ(rules[1].from, String(IMG_TEXT("DSC")));
+  CHECK_EQ(rules[1].to, String(IMG_TEXT("Sony {Model}")));   // the rest of the line, inner blanks kept
+  CHECK_EQ(rules[2].from, String(IMG_TEXT("P1")));
+  CHECK_EQ(rules[2].to, String(IMG_TEXT("")));           // prefix dropped
+  CHECK_EQ(rules[3].to, String(IMG_TEXT("Canon_raw_")));
+}
+
+TEST(Rules_FileErrors)
+{
+  Test::TempDir dir{};
+  dir.Touch(IMG_TEXT("rules"), "IMG_ A_\nDSC B_\nIMG_ C_\n");
+  try
+  {
+    Engine::LoadRules(dir / IMG_TEXT("rules"));
+    CHECK(!"duplicate prefix accepted");
+  }
+  catch (const Engine::Error& e)
+  {
+    CHECK_EQ(std::string(e.what()), std::string("duplicate prefix in line 3"));
+  }
+  CHECK_THROWS(Engine::LoadRules(dir / IMG_TEXT("missing")));
+}
+
+TEST(Rules_NamesCollidingWithinTheRun)
+{
+  // two rules giving two files the same new name: the second in name order gets the suffix
+  Test::TempDir dir{};
+  dir.Touch(IMG_TEXT("A_1.JPG"));
+  dir.Touch(IMG_TEXT("B_1.JPG"));
+  Engine::Options options{};
+  options.path = dir.Path();
+  options.rules = { Rule{ IMG_TEXT("A_"), IMG_TEXT("X_") }, Rule{ IMG_TEXT("B_"), IMG_TEXT("X_") } };
+  options.collision = Engine::Collision::Suffix;
+  Engine::Result result = Engine::Renamer(options).Run();
+  CHECK_EQ(result.renamed, 2u);
+  CHECK_EQ(dir.Names(), (std::vector<String>{ IMG_TEXT("X_1.JPG"), IMG_TEXT("X_1_1.JPG") }));
+}
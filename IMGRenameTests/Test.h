@@ -0,0 +1,96 @@
+// Test.h : a minimal test harness for the engine; no dependencies beyond the standard library
+//
+
+#pragma once
+
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+
+using Engine::Char;
+using Engine::String;
+using Engine::StringView;
+
+namespace Test
+{
+
+  struct Case
+  {
+    const char* name;                                    // Suite_What; the suite is what ctest runs as one test
+    void (*run)();
+  };
+
+  std::vector<Case>& Cases();
+
+  struct Register
+  {
+    Register(const char* name, void (*run)()) { Cases().push_back(Case{ name, run }); }
+  };
+
+  void Fail(const char* file, int line, const std::string& what);   // records a failed check, the case carries on
+
+  // A fresh, empty directory below the system's temporary directory, removed with everything in it at the end of scope
+  class TempDir
+  {
+  public:
+    TempDir();
+    ~TempDir();
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    const String& Path() const { return m_path; }
+    String operator/(StringView name) const { return m_path + Engine::Separator + String(name); }
+    void Touch(StringView name, const std::string& content = {}) const;   // creates name, or overwrites it, with content
+    bool Exists(StringView name) const;
+    std::vector<String> Names() const;                   // the entries, sorted
+
+  private:
+    String m_path;
+  };
+
+  template <typename T> std::string Show(const T& v)
+  {
+    std::ostringstream s;
+    s << v;
+    return s.str();
+  }
+
+  std::string Show(const std::wstring& v);
+  std::string Show(const std::wstring_view& v);
+
+  template <typename T> std::string Show(const std::vector<T>& v)
+  {
+    std::string s = "{";
+    for (size_t i = 0; i < v.size(); ++i) s += (i == 0 ? " " : ", ") + Show(v[i]);
+    return s + " }";
+  }
+
+}
+
+#define TEST(name)                                                       \
+  static void name();                                                    \
+  static const Test::Register name##Registration(#name, name);          \
+  static void name()
+
+#define CHECK(e)                                                         \
+  do { if (!(e)) Test::Fail(__FILE__, __LINE__, #e); } while (false)
+
+#define CHECK_EQ(a, b)                                                   \
+  do                                                                     \
+  {                                                                      \
+    auto&& checkA = (a);                                                 \
+    auto&& checkB = (b);                                                 \
+    if (!(checkA == checkB))                                             \
+      Test::Fail(__FILE__, __LINE__, std::string(#a " == " #b ": ") + Test::Show(checkA) + " != " + Test::Show(checkB));   \
+  } while (false)
+
+#define CHECK_THROWS(e)                                                  \
+  do                                                                     \
+  {                                                                      \
+    bool checkThrown = false;                                            \
+    try { e; } catch (const std::exception&) { checkThrown = true; }     \
+    if (!checkThrown) Test::Fail(__FILE__, __LINE__, #e " did not throw");   \
+  } while (false)
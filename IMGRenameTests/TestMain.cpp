@@ -0,0 +1,103 @@
+// TestMain.cpp : runs the cases whose name starts with the first argument, or all of them
+//
+
+#include <algorithm>        // For std::sort
+#include <atomic>
+#include <cstring>          // For strncmp()
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "Test.h"
+
+namespace fs = std::filesystem;
+
+namespace Test
+{
+
+  static size_t failures = 0;
+
+  std::vector<Case>& Cases()
+  {
+    static std::vector<Case> cases{};
+    return cases;
+  }
+
+  void Fail(const char* file, int line, const std::string& what)
+  {
+    std::cerr << file << "(" << line << "): check failed: " << what << std::endl;
+    ++failures;
+  }
+
+  std::string Show(const std::wstring& v)
+  {
+    return std::string(v.begin(), v.end());              // test names are ASCII
+  }
+
+  std::string Show(const std::wstring_view& v)
+  {
+    return std::string(v.begin(), v.end());
+  }
+
+  TempDir::TempDir()
+  {
+    static std::atomic<unsigned> serial{};
+    std::random_device random{};
+    fs::path path = fs::temp_directory_path() / ("IMGRenameTests-" + std::to_string(random()) + "-" + std::to_string(++serial));
+    fs::create_directories(path);
+    m_path = path.native();
+  }
+
+  TempDir::~TempDir()
+  {
+    std::error_code ignored{};
+    fs::remove_all(m_path, ignored);
+  }
+
+  void TempDir::Touch(StringView name, const std::string& content) const
+  {
+    std::ofstream file(fs::path(*this / name), std::ios::binary | std::ios::trunc);
+    file << content;
+  }
+
+  bool TempDir::Exists(StringView name) const
+  {
+    return fs::exists(fs::path(*this / name));
+  }
+
+  std::vector<String> TempDir::Names() const
+  {
+    std::vector<String> names{};
+    for (const fs::directory_entry& e : fs::directory_iterator(m_path)) names.push_back(e.path().filename().native());
+    std::sort(names.begin(), names.end());
+    return names;
+  }
+
+}
+
+int main(int argc, char* argv[])
+{
+  const char* filter = argc > 1 ? argv[1] : "";
+  size_t run = 0;
+  for (const Test::Case& c : Test::Cases())
+  {
+    if (strncmp(c.name, filter, strlen(filter)) != 0) continue;
+    size_t before = Test::failures;
+    try
+    {
+      c.run();
+    }
+    catch (const std::exception& e)
+    {
+      Test::Fail(c.name, 0, std::string("unexpected exception: ") + e.what());
+    }
+    std::cout << (Test::failures == before ? "ok     " : "FAILED ") << c.name << std::endl;
+    ++run;
+  }
+  if (run == 0)
+  {
+    std::cerr << "no test case starts with \"" << filter << "\"" << std::endl;
+    return 1;
+  }
+  return Test::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+// ThrottleTests.cpp : the adaptive limit on ops in flight, fed with made up latencies
+//
+
+#include <chrono>
+#include <functional>
+
+#include "Throttle.h"
+#include "Test.h"
+
+using Engine::Throttle;
+
+// fill every place, then complete them all with the latency latency(n) for n in flight; returns the limit after rounds
+static unsigned Run(Throttle& throttle, unsigned rounds, const std::function<double(unsigned)>& latency)
+{
+  for (unsigned r = 0; r < rounds; ++r)
+  {
+    unsigned n = 0;
+    while (throttle.TryAcquire()) ++n;
+    for (unsigned i = 0; i < n; ++i) throttle.Release(std::chrono::duration_cast<Throttle::Clock::duration>(std::chrono::duration<double>(latency(n))));
+  }
+  return throttle.Limit();
+}
+
+TEST(Throttle_FixedUnlessAdaptive)
+{
+  Throttle throttle(64, false, nullptr);
+  CHECK_EQ(throttle.Limit(), 64u);
+  CHECK_EQ(Run(throttle, 10, [](unsigned n) { return n * 1e-3; }), 64u);
+}
+
+TEST(Throttle_LocalDiskReachesTheMaximum)
+{
+  // flat latency, and latency growing with what is in flight, as renames batched into one ring do
+  Throttle flat(256, true, nullptr);
+  CHECK_EQ(flat.Limit(), 4u);
+  CHECK_EQ(Run(flat, 100, [](unsigned) { return 50e-6; }), 256u);
+  Throttle batched(256, true, nullptr);
+  CHECK_EQ(Run(batched, 100, [](unsigned n) { return 10e-6 * n; }), 256u);
+}
+
+TEST(Throttle_OneFastRoundDoesNotPinTheBaseline)
+{
+  Throttle throttle(256, true, nullptr);
+  unsigned round = 0;
+  CHECK_EQ(Run(throttle, 100, [&](unsigned) { return ++round <= 4 ? 1e-6 : 100e-6; }), 256u);
+}
+
+TEST(Throttle_BacksOffWhenLatencyJumps)
+{
+  Throttle throttle(256, true, nullptr);
+  CHECK_EQ(Run(throttle, 100, [](unsigned) { return 1e-3; }), 256u);
+  // a filer that can take 16 at a time and queues the rest behind them, at 10 ms each
+  unsigned limit = Run(throttle, 100, [](unsigned n) { return n <= 16 ? 1e-3 : 10e-3 * n / 16; });
+  CHECK(limit < 64);
+  CHECK(limit >= 4);
+}
@@ -0,0 +1,89 @@
+// WatcherTests.cpp : watch mode, renaming files as they arrive
+//
+
+#ifdef __linux__
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#include "Watcher.h"
+#include "Test.h"
+
+namespace fs = std::filesystem;
+
+// a watcher over dir on a thread of its own, stopped at the end of scope
+class Watching
+{
+public:
+  Watching(const Test::TempDir& dir, bool subdir)
+  {
+    Engine::Options options{};
+    options.path = dir.Path();
+    options.from = IMG_TEXT("IMG_");
+    options.to = IMG_TEXT("X_");
+    options.subdir = subdir;
+    m_thread = std::thread([this, options]
+      {
+        Engine::Watcher watcher(options, 10);
+        watcher.Run(m_stop, [this](const Engine::Result&) { ++m_reports; });
+      });
+    Wait([this] { return m_reports > 0; });              // the first full run is over, the watches are in place
+  }
+  ~Watching()
+  {
+    m_stop = true;
+    m_thread.join();
+  }
+
+  template <typename Done> static bool Wait(Done done)   // false if it didn't happen within 5 s
+  {
+    for (int i = 0; i < 500; ++i)
+    {
+      if (done()) return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+private:
+  std::atomic<bool> m_stop{};
+  std::atomic<unsigned> m_reports{};
+  std::thread m_thread;
+};
+
+// a directory with a matching file in it, made elsewhere and moved below the root in one step
+static void MoveIn(const Test::TempDir& dir)
+{
+  Test::TempDir elsewhere{};
+  fs::create_directory(fs::path(elsewhere / IMG_TEXT("sub")));
+  elsewhere.Touch(IMG_TEXT("sub/IMG_1.JPG"));
+  fs::rename(fs::path(elsewhere / IMG_TEXT("sub")), fs::path(dir / IMG_TEXT("sub")));
+}
+
+TEST(Watcher_RenamesNewSubtrees)
+{
+  Test::TempDir dir{};
+  Watching watching(dir, true);
+  MoveIn(dir);
+  CHECK(Watching::Wait([&] { return dir.Exists(IMG_TEXT("sub/X_1.JPG")); }));
+  dir.Touch(IMG_TEXT("sub/IMG_2.JPG"));                  // and watches them from then on
+  CHECK(Watching::Wait([&] { return dir.Exists(IMG_TEXT("sub/X_2.JPG")); }));
+}
+
+TEST(Watcher_LeavesSubdirectoriesAloneUnlessAsked)
+{
+  Test::TempDir dir{};
+  Watching watching(dir, false);
+  MoveIn(dir);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));   // time enough to put a watch on sub, if it were to
+  dir.Touch(IMG_TEXT("sub/IMG_3.JPG"));
+  dir.Touch(IMG_TEXT("IMG_2.JPG"));                      // comes after the others' events, in the same or a later batch
+  CHECK(Watching::Wait([&] { return dir.Exists(IMG_TEXT("X_2.JPG")); }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  CHECK(dir.Exists(IMG_TEXT("sub/IMG_1.JPG")));
+  CHECK(dir.Exists(IMG_TEXT("sub/IMG_3.JPG")));
+}
+
+#endif // __linux__